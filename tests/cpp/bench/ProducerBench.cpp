@@ -0,0 +1,102 @@
+/**
+ * @file ProducerBench.cpp
+ * @brief 複数スレッドからの発行について、publishConcurrent()とミューテックスで排他したpublish()の送信レートを比較するベンチマーク
+ * @details 送信スレッド数を1から指定数まで変えて、それぞれの方式で一定数のメッセージを発行する時間を計る。
+ * 使い方: ProducerBench [最大送信スレッド数(既定:8)] [1回の計測のメッセージ数(既定:200000)] [メッセージ本体のバイト数(既定:200)]
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MqttBridge.hpp"
+
+namespace
+{
+    constexpr int kSenderPort = 47501;   //! 送信側のポート番号
+    constexpr int kReceiverPort = 47502; //! 受信側のポート番号
+
+    /**
+     * @brief 送信スレッドを起動し、全スレッドが発行を終えるまでの送信レートを返します
+     *
+     * @param producers 送信スレッド数
+     * @param messages 全スレッド合計のメッセージ数
+     * @param publish 1件発行する関数
+     * @return double 送信レート[msg/s]
+     */
+    template <class Publish>
+    double measure(size_t producers, size_t messages, Publish publish)
+    {
+        const size_t perThread = messages / producers;
+        std::vector<std::thread> threads;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < producers; ++i)
+        {
+            threads.emplace_back([&]()
+                                 {
+                for (size_t n = 0; n < perThread; ++n)
+                {
+                    publish();
+                } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return static_cast<double>(perThread * producers) / seconds;
+    }
+
+    /**
+     * @brief 受信側に溜まったメッセージを読み捨てます
+     */
+    void drain(MqttBridge &receiver)
+    {
+        while (!receiver.subscribeBatch(256, 0).empty())
+        {
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t maxProducers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+    const size_t messages = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200000;
+    const size_t payloadSize = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 200;
+    if (maxProducers == 0 || messages < maxProducers)
+    {
+        std::fprintf(stderr, "usage: %s [maxProducers] [messages] [payloadSize]\n", argv[0]);
+        return 1;
+    }
+
+    MqttBridge sender("127.0.0.1", kSenderPort, "127.0.0.1", kReceiverPort);
+    MqttBridge receiver("127.0.0.1", kReceiverPort, "127.0.0.1", kSenderPort);
+    const std::string payload(payloadSize, 'x');
+    std::mutex mutex;
+
+    std::printf("producers,mutex_publish_msg_per_s,publish_concurrent_msg_per_s,speedup\n");
+    for (size_t producers = 1; producers <= maxProducers; ++producers)
+    {
+        const double locked = measure(producers, messages, [&]()
+                                      {
+            std::lock_guard<std::mutex> lock(mutex);
+            sender.publish("bench", payload); });
+        drain(receiver);
+        const double concurrent = measure(producers, messages, [&]()
+                                          { sender.publishConcurrent("bench", payload); });
+        drain(receiver);
+        std::printf("%zu,%.0f,%.0f,%.2f\n", producers, locked, concurrent, concurrent / locked);
+    }
+    const ProducerStats stats = sender.producerStats();
+    std::printf("# concurrent: threads=%llu sockets=%llu sent=%llu sendErrors=%llu\n",
+                static_cast<unsigned long long>(stats.threads), static_cast<unsigned long long>(stats.sockets),
+                static_cast<unsigned long long>(stats.sent), static_cast<unsigned long long>(stats.sendErrors));
+    return 0;
+}
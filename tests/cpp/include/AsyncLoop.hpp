@@ -0,0 +1,648 @@
+/**
+ * @file AsyncLoop.hpp
+ * @brief トランスポート(UdpHandlerなど)とMQTT中継をco_awaitで扱うためのコルーチン用イベントループの定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている。
+ * C++20のコルーチンが利用できない場合(C++17でのビルドなど)は何も定義しない
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef ASYNC_LOOP_HPP_
+#define ASYNC_LOOP_HPP_
+
+#include "EventReactor.hpp"
+#include "MqttBridge.hpp"
+
+#ifdef UDP_HANDLER_HAS_COROUTINE
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "spdlog/spdlog.h"
+
+/**
+ * @brief 呼び出すと直ちに実行を開始する投げっぱなしのコルーチン
+ * @details 戻り値を受け取る必要はない。完了するとフレームは自動で解放される。
+ * 捕捉されなかった例外はログ出力して破棄する
+ */
+class AsyncTask
+{
+public:
+    struct promise_type
+    {
+        AsyncTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept
+        {
+            try
+            {
+                std::rethrow_exception(std::current_exception());
+            }
+            catch (const std::exception &ex)
+            {
+                spdlog::error(std::string("AsyncTask failed: ") + ex.what());
+            }
+            catch (...)
+            {
+                spdlog::error("AsyncTask failed");
+            }
+        }
+    };
+};
+
+/**
+ * @brief 中断中のコルーチン1つ分の待機状態
+ * @details 各awaitableがコルーチンフレーム内に保持し、AsyncLoopの待機キューとタイマから参照される
+ */
+struct AsyncWaiter
+{
+    using Queue = std::list<AsyncWaiter *>;
+    using Timers = std::multimap<std::chrono::steady_clock::time_point, AsyncWaiter *>;
+
+    std::coroutine_handle<> handle;    //! 再開するコルーチン
+    std::optional<std::string> result; //! 受信結果(タイムアウト時はstd::nullopt)
+    std::string_view payload;          //! 送信待ちのデータグラム
+    int error{0};                      //! 送信結果のエラーコード
+    Queue *queue{nullptr};             //! 登録中の待機キュー
+    Queue::iterator position;          //! 待機キュー内の位置
+    bool hasTimer{false};              //! タイムアウトを設定しているか
+    Timers::iterator timer;            //! タイムアウトの登録位置
+};
+
+/**
+ * @brief コルーチンを単一スレッドで駆動するイベントループ
+ * @details EventReactorの上で動作し、ソケットが受信可能(送信可能)になると待機中のコルーチンを再開する。
+ * 待機中のコルーチンはスレッドを占有しないため、1つのスレッドで多数の論理的な購読者を扱える。
+ * 監視の登録・解除は待機状況に合わせてrunOnce()の先頭でまとめて行う。
+ * スレッドセーフではないため、全ての操作はループを駆動するスレッドから行うこと。
+ * 待機に使用したトランスポートはループより長く存在すること。ループを破棄した時点で中断中のコルーチンは再開されない
+ */
+class AsyncLoop
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    AsyncLoop() = default;
+    AsyncLoop(const AsyncLoop &) = delete;
+    AsyncLoop &operator=(const AsyncLoop &) = delete;
+
+    /**
+     * @brief 内部のイベントリアクタを返します
+     * @details 周期タイマなど、コルーチン以外の処理を同じスレッドで駆動するために使用する
+     * @return EventReactor&
+     */
+    EventReactor &reactor() { return m_reactor; }
+
+    /**
+     * @brief イベントを1回待機して処理します
+     *
+     * @param maxWaitMs 最大待機時間[msec]
+     * @return true 待機が正常に終了した
+     * @return false 待機処理でエラーが発生した
+     */
+    bool runOnce(int maxWaitMs)
+    {
+        syncWatches();
+        int timeoutMs = maxWaitMs;
+        if (!m_timers.empty())
+        {
+            const auto until = m_timers.begin()->first - Clock::now();
+            const auto untilMs = std::chrono::ceil<std::chrono::milliseconds>(until).count();
+            const long long limit = timeoutMs < 0 ? INT_MAX : timeoutMs;
+            timeoutMs = static_cast<int>(std::max<long long>(0, std::min<long long>(limit, untilMs)));
+        }
+        const bool ok = m_reactor.runOnce(timeoutMs);
+        expireTimers();
+        return ok;
+    }
+
+    /**
+     * @brief 停止フラグが立つまでイベントを処理し続けます
+     *
+     * @param stopFlag 停止フラグ
+     * @param maxWaitMs 停止フラグを確認する最大間隔[msec]
+     */
+    void run(const std::atomic<bool> &stopFlag, int maxWaitMs = 100)
+    {
+        while (!stopFlag.load())
+        {
+            if (!runOnce(maxWaitMs))
+            {
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief 指定時間だけコルーチンを中断します(co_await用)
+     */
+    class Sleep
+    {
+    public:
+        Sleep(AsyncLoop &loop, std::chrono::milliseconds duration) : m_loop(loop), m_duration(duration) {}
+        Sleep(const Sleep &) = delete;
+        bool await_ready() const noexcept { return m_duration.count() <= 0; }
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            m_waiter.handle = handle;
+            m_loop.startTimer(m_waiter, static_cast<int>(m_duration.count()));
+        }
+        void await_resume() const noexcept {}
+
+    private:
+        AsyncLoop &m_loop;
+        std::chrono::milliseconds m_duration;
+        AsyncWaiter m_waiter;
+    };
+
+    /**
+     * @brief 指定時間だけコルーチンを中断します
+     *
+     * @param duration 中断する時間
+     * @return Sleep co_awaitで待機するawaitable
+     */
+    Sleep sleep_for(std::chrono::milliseconds duration) { return Sleep(*this, duration); }
+
+    /**
+     * @brief 購読待ちのコルーチンが無いトピックのメッセージを、保留数の上限を超えたため破棄した数を返します
+     *
+     * @return uint64_t
+     */
+    uint64_t subscribeDropped() const { return m_subscribeDropped; }
+
+    /**
+     * @brief 受信したメッセージ(トピック、メッセージ本体)を受け取る関数
+     */
+    using MessageSink = std::function<void(std::string_view, std::string_view)>;
+
+    /**
+     * @brief MQTT中継の受信処理を呼び出し、解釈済みのメッセージをMessageSinkに渡す関数
+     * @details 引数は1回で取り出す最大データグラム数と渡し先。戻り値は受信したメッセージ数
+     */
+    using MessagePump = std::function<size_t(size_t, const MessageSink &)>;
+
+private:
+    friend class AsyncReceive;
+    friend class AsyncSend;
+    friend class AsyncSubscribe;
+
+    /**
+     * @brief トランスポートごとの受信待ち
+     */
+    struct ReceiveChannel
+    {
+        AsyncWaiter::Queue waiters; //! 受信待ちのコルーチン(待機開始順)
+        socket_t watching{INVALID_SOCK}; //! 監視中のハンドル
+    };
+
+    /**
+     * @brief トランスポートごとの送信待ち
+     */
+    struct SendChannel
+    {
+        AsyncWaiter::Queue waiters; //! 送信待ちのコルーチン(待機開始順)
+        bool watching{false};       //! 送信可能イベントを監視中か
+    };
+
+    /**
+     * @brief 購読したトピックごとの待機状態
+     */
+    struct SubscribeTopic
+    {
+        AsyncWaiter::Queue waiters;      //! 購読待ちのコルーチン(待機開始順)
+        std::deque<std::string> backlog; //! 購読待ちが無い間に届いたメッセージ(次の購読で1件ずつ渡す)
+    };
+
+    /**
+     * @brief MQTT中継ごとのトピック別購読待ち
+     */
+    struct SubscribeChannel
+    {
+        std::map<std::string, SubscribeTopic, std::less<>> topics; //! トピックごとの購読待ちと保留中のメッセージ
+        MessagePump pump;                                         //! MQTT中継の受信処理
+        socket_t watching{INVALID_SOCK};                          //! 監視中のハンドル
+    };
+
+    /**
+     * @brief 待機キューに登録します
+     *
+     * @param waiter 待機状態
+     * @param queue 登録先の待機キュー
+     * @param timeoutMs タイムアウト時間[msec](負の場合は無期限)
+     */
+    void enqueue(AsyncWaiter &waiter, AsyncWaiter::Queue &queue, int timeoutMs)
+    {
+        waiter.queue = &queue;
+        waiter.position = queue.insert(queue.end(), &waiter);
+        if (timeoutMs >= 0)
+        {
+            startTimer(waiter, timeoutMs);
+        }
+        m_dirty = true;
+    }
+
+    /**
+     * @brief タイムアウトを登録します
+     *
+     * @param waiter 待機状態
+     * @param timeoutMs タイムアウト時間[msec]
+     */
+    void startTimer(AsyncWaiter &waiter, int timeoutMs)
+    {
+        waiter.timer = m_timers.emplace(Clock::now() + std::chrono::milliseconds(timeoutMs), &waiter);
+        waiter.hasTimer = true;
+    }
+
+    /**
+     * @brief 待機キューとタイマから外します
+     *
+     * @param waiter 待機状態
+     */
+    void detach(AsyncWaiter &waiter)
+    {
+        if (waiter.queue != nullptr)
+        {
+            waiter.queue->erase(waiter.position);
+            waiter.queue = nullptr;
+            m_dirty = true;
+        }
+        if (waiter.hasTimer)
+        {
+            m_timers.erase(waiter.timer);
+            waiter.hasTimer = false;
+        }
+    }
+
+    /**
+     * @brief 待機キューとタイマから外し、コルーチンを再開します
+     *
+     * @param waiter 待機状態
+     */
+    void complete(AsyncWaiter &waiter)
+    {
+        detach(waiter);
+        waiter.handle.resume();
+    }
+
+    /**
+     * @brief 期限を過ぎた待機をタイムアウトとして再開します
+     *
+     */
+    void expireTimers()
+    {
+        // 再開したコルーチンが登録したタイムアウトは次回に処理する
+        const auto now = Clock::now();
+        while (!m_timers.empty() && m_timers.begin()->first <= now)
+        {
+            complete(*m_timers.begin()->second);
+        }
+    }
+
+    /**
+     * @brief 待機状況に合わせてソケットの監視を登録・解除します
+     * @details ハンドラの実行中に自身を登録解除しないよう、待機前にまとめて行う。
+     * 待ちが無いソケットを監視し続けると、レベルトリガのため受信可能イベントが発生し続ける
+     */
+    void syncWatches()
+    {
+        if (!m_dirty)
+        {
+            return;
+        }
+        m_dirty = false;
+        for (auto &[handler, channel] : m_receivers)
+        {
+            DatagramTransport *target = handler;
+            watchReadable(channel.watching, !channel.waiters.empty(), target, [this, target]()
+                          { onReadable(*target); });
+        }
+        for (auto &[bridge, channel] : m_subscribers)
+        {
+            // 購読したことのあるトピックは、待機中のコルーチンが無くても保留先として残す
+            bool needed = false;
+            for (const auto &[topic, entry] : channel.topics)
+            {
+                needed = needed || !entry.waiters.empty();
+            }
+            DatagramTransport *target = bridge;
+            watchReadable(channel.watching, needed, target, [this, target]()
+                          { onMessage(*target); });
+        }
+        for (auto &[handler, channel] : m_senders)
+        {
+            const bool needed = !channel.waiters.empty();
+            if (needed != channel.watching)
+            {
+                DatagramTransport *target = handler;
+                if (needed)
+                {
+                    m_reactor.addWriter(target->sendSocket(), [this, target]()
+                                        { onWritable(*target); });
+                }
+                else
+                {
+                    m_reactor.removeWriter(target->sendSocket());
+                }
+                channel.watching = needed;
+            }
+        }
+    }
+
+    /**
+     * @brief 受信可能イベントの監視状態を更新します
+     *
+     * @param watching 監視中のハンドル(未監視の場合はINVALID_SOCK)
+     * @param needed 監視が必要か
+     * @param target 監視するトランスポート(不要な場合は参照しない)
+     * @param onReadable 受信可能になったときに呼び出すハンドラ
+     */
+    void watchReadable(socket_t &watching, bool needed, DatagramTransport *target, EventReactor::Handler onReadable)
+    {
+        const socket_t handle = needed ? target->eventHandle() : INVALID_SOCK;
+        if (watching == handle)
+        {
+            return;
+        }
+        if (watching != INVALID_SOCK)
+        {
+            m_reactor.removeReader(watching);
+        }
+        if (needed)
+        {
+            m_reactor.addReader(handle, std::move(onReadable));
+        }
+        watching = handle;
+    }
+
+    /**
+     * @brief 受信可能になったトランスポートのメッセージを待機順にコルーチンへ渡します
+     *
+     * @param handler 受信可能になったトランスポート
+     */
+    void onReadable(DatagramTransport &handler)
+    {
+        auto &waiters = m_receivers[&handler].waiters;
+        while (!waiters.empty())
+        {
+            auto datagram = handler.receiveView(0);
+            if (!datagram)
+            {
+                break;
+            }
+            // 受信バッファは次の受信で上書きされるため、コピーして渡す
+            AsyncWaiter &waiter = *waiters.front();
+            waiter.result.emplace(*datagram);
+            complete(waiter);
+        }
+    }
+
+    /**
+     * @brief 受信可能になったMQTT中継のメッセージを、トピックを待機している全てのコルーチンへ渡します
+     * @details 受信と解釈はMQTT中継の受信処理(dispatch()と同じ)で行うため、エンベロープの展開、断片の再構成、
+     * 通し番号の追跡、ハンドラの呼び出しと統計はMQTT中継の設定に従う。
+     * 受信処理は受信バッファを参照しながらメッセージを渡すため、コルーチンは受信処理が終わってから再開する
+     * (再開したコルーチンが同じMQTT中継で受信しても、処理中のメッセージを上書きしない)。
+     * 購読したことのあるトピックで待機中のコルーチンが無いメッセージは、トピックごとにkSubscribeBacklog件まで保留し、
+     * 次にそのトピックを購読したコルーチンに渡す(超えた場合は古いものから破棄し、subscribeDropped()に数える)
+     * @param bridge 受信可能になったMQTT中継のトランスポート
+     */
+    void onMessage(DatagramTransport &bridge)
+    {
+        auto &channel = m_subscribers[&bridge];
+        auto &topics = channel.topics;
+        std::vector<AsyncWaiter *> ready;
+        const MessageSink deliver = [&](std::string_view topic, std::string_view message)
+        {
+            auto it = topics.find(topic);
+            if (it == topics.end())
+            {
+                return;
+            }
+            SubscribeTopic &entry = it->second;
+            if (entry.waiters.empty())
+            {
+                if (entry.backlog.size() >= kSubscribeBacklog)
+                {
+                    entry.backlog.pop_front();
+                    m_subscribeDropped++;
+                }
+                entry.backlog.emplace_back(message);
+                return;
+            }
+            while (!entry.waiters.empty())
+            {
+                AsyncWaiter &waiter = *entry.waiters.front();
+                waiter.result.emplace(message);
+                detach(waiter);
+                ready.push_back(&waiter);
+            }
+        };
+        channel.pump(kSubscribeBatch, deliver);
+        for (AsyncWaiter *waiter : ready)
+        {
+            waiter->handle.resume();
+        }
+    }
+
+    /**
+     * @brief 送信可能になったトランスポートで、送信待ちのメッセージを待機順に送信します
+     *
+     * @param handler 送信可能になったトランスポート
+     */
+    void onWritable(DatagramTransport &handler)
+    {
+        auto &waiters = m_senders[&handler].waiters;
+        while (!waiters.empty())
+        {
+            AsyncWaiter &waiter = *waiters.front();
+            const int err = handler.trySend(waiter.payload);
+            if (err == EAGAIN || err == EWOULDBLOCK)
+            {
+                break;
+            }
+            waiter.error = err;
+            complete(waiter);
+        }
+    }
+
+private:
+    static constexpr size_t kSubscribeBatch = 64;    //! 購読待ちへの配送で1回に取り出す最大メッセージ数
+    static constexpr size_t kSubscribeBacklog = 256; //! 購読待ちが無いトピックごとに保留する最大メッセージ数
+
+    EventReactor m_reactor;                                        //! ソケットイベントの待機
+    AsyncWaiter::Timers m_timers;                                  //! 期限順のタイムアウト
+    std::unordered_map<DatagramTransport *, ReceiveChannel> m_receivers;  //! トランスポートごとの受信待ち
+    std::unordered_map<DatagramTransport *, SendChannel> m_senders;       //! トランスポートごとの送信待ち
+    std::unordered_map<DatagramTransport *, SubscribeChannel> m_subscribers; //! MQTT中継ごとの購読待ち
+    bool m_dirty{false};                                           //! 監視状態の更新が必要か
+    uint64_t m_subscribeDropped{0};                                //! 保留数の上限を超えて破棄したメッセージ数
+};
+
+/**
+ * @brief DatagramTransport::async_receive()のawaitable
+ */
+class AsyncReceive
+{
+public:
+    AsyncReceive(AsyncLoop &loop, DatagramTransport &handler, int timeoutMs)
+        : m_loop(loop), m_handler(handler), m_timeoutMs(timeoutMs) {}
+    AsyncReceive(const AsyncReceive &) = delete;
+
+    bool await_ready()
+    {
+        // 先に待機しているコルーチンが無ければ、受信済みのデータグラムを直ちに受け取る
+        if (!m_loop.m_receivers[&m_handler].waiters.empty())
+        {
+            return false;
+        }
+        if (auto datagram = m_handler.receiveView(0))
+        {
+            m_waiter.result.emplace(*datagram);
+            return true;
+        }
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_waiter.handle = handle;
+        m_loop.enqueue(m_waiter, m_loop.m_receivers[&m_handler].waiters, m_timeoutMs);
+    }
+    std::optional<std::string> await_resume() { return std::move(m_waiter.result); }
+
+private:
+    AsyncLoop &m_loop;
+    DatagramTransport &m_handler;
+    int m_timeoutMs;
+    AsyncWaiter m_waiter;
+};
+
+/**
+ * @brief DatagramTransport::async_send()のawaitable
+ */
+class AsyncSend
+{
+public:
+    AsyncSend(AsyncLoop &loop, DatagramTransport &handler, std::string_view payload)
+        : m_loop(loop), m_handler(handler)
+    {
+        m_waiter.payload = payload;
+    }
+    AsyncSend(const AsyncSend &) = delete;
+
+    bool await_ready()
+    {
+        // 送信順を保つため、先に待機しているコルーチンがある場合は後ろに並ぶ
+        if (!m_loop.m_senders[&m_handler].waiters.empty())
+        {
+            return false;
+        }
+        m_waiter.error = m_handler.trySend(m_waiter.payload);
+        return m_waiter.error != EAGAIN && m_waiter.error != EWOULDBLOCK;
+    }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_waiter.handle = handle;
+        m_loop.enqueue(m_waiter, m_loop.m_senders[&m_handler].waiters, -1);
+    }
+    int await_resume() const noexcept { return m_waiter.error; }
+
+private:
+    AsyncLoop &m_loop;
+    DatagramTransport &m_handler;
+    AsyncWaiter m_waiter;
+};
+
+/**
+ * @brief BasicMqttBridge::async_subscribe()のawaitable
+ */
+class AsyncSubscribe
+{
+public:
+    AsyncSubscribe(AsyncLoop &loop, DatagramTransport &bridge, AsyncLoop::MessagePump pump, std::string topic, int timeoutMs)
+        : m_loop(loop), m_bridge(bridge), m_pump(std::move(pump)), m_topic(std::move(topic)), m_timeoutMs(timeoutMs) {}
+    AsyncSubscribe(const AsyncSubscribe &) = delete;
+
+    bool await_ready()
+    {
+        // 待機中のコルーチンが無い間に届いて保留したメッセージがあれば、直ちに受け取る
+        auto channel = m_loop.m_subscribers.find(&m_bridge);
+        if (channel == m_loop.m_subscribers.end())
+        {
+            return false;
+        }
+        auto it = channel->second.topics.find(m_topic);
+        if (it == channel->second.topics.end() || it->second.backlog.empty())
+        {
+            return false;
+        }
+        m_waiter.result.emplace(std::move(it->second.backlog.front()));
+        it->second.backlog.pop_front();
+        return true;
+    }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_waiter.handle = handle;
+        auto &channel = m_loop.m_subscribers[&m_bridge];
+        if (!channel.pump)
+        {
+            channel.pump = std::move(m_pump);
+        }
+        auto &topics = channel.topics;
+        auto it = topics.find(m_topic);
+        if (it == topics.end())
+        {
+            it = topics.emplace(m_topic, AsyncLoop::SubscribeTopic{}).first;
+        }
+        m_loop.enqueue(m_waiter, it->second.waiters, m_timeoutMs);
+    }
+    std::optional<std::string> await_resume() { return std::move(m_waiter.result); }
+
+private:
+    AsyncLoop &m_loop;
+    DatagramTransport &m_bridge;
+    AsyncLoop::MessagePump m_pump;
+    std::string m_topic;
+    int m_timeoutMs;
+    AsyncWaiter m_waiter;
+};
+
+inline AsyncReceive DatagramTransport::async_receive(AsyncLoop &loop, int timeoutMs)
+{
+    return AsyncReceive(loop, *this, timeoutMs);
+}
+
+inline AsyncSend DatagramTransport::async_send(AsyncLoop &loop, std::string_view payload)
+{
+    return AsyncSend(loop, *this, payload);
+}
+
+template <class Transport>
+inline AsyncSubscribe BasicMqttBridge<Transport>::async_subscribe(AsyncLoop &loop, std::string topic, int timeoutMs)
+{
+    // 受信した全メッセージをdispatch()と同じ処理で解釈させてから、購読待ちのコルーチンへ配送する
+    AsyncLoop::MessagePump pump = [this](size_t maxCount, const AsyncLoop::MessageSink &sink)
+    {
+        return dispatchBatch(maxCount, 0, sink);
+    };
+    return AsyncSubscribe(loop, *this, std::move(pump), std::move(topic), timeoutMs);
+}
+
+#endif // UDP_HANDLER_HAS_COROUTINE
+
+#endif // ASYNC_LOOP_HPP_
@@ -0,0 +1,139 @@
+/**
+ * @file Conflator.hpp
+ * @brief トピックごとに最新のメッセージのみを保持して送信する間引き処理の定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef CONFLATOR_HPP_
+#define CONFLATOR_HPP_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "TopicRegistry.hpp"
+
+/**
+ * @brief 間引き処理の統計値
+ */
+struct ConflationStats
+{
+    uint64_t updates{0};   //! 受け付けたメッセージ数
+    uint64_t conflated{0}; //! 送信前に新しいメッセージで上書きされ、送信されなかったメッセージ数
+    uint64_t flushed{0};   //! 送信したメッセージ数
+    uint64_t flushes{0};   //! flush()の呼び出しで1件以上送信した回数
+    size_t topics{0};      //! 保持しているトピック数
+    size_t pending{0};     //! 送信待ちのトピック数
+};
+
+/**
+ * @brief トピックごとに送信待ちの枠を1つだけ持ち、flush()で最新のメッセージのみを送信するクラス
+ * @details 同じトピックへの更新が送信前に重なった場合は、古いメッセージを上書きして数える。
+ * 1回のflush()で送信するメッセージ数はトピック数以下となるため、更新が集中しても送信量はトピック数で抑えられる。
+ * 送信順は各トピックが送信待ちになった順。枠はトピックのID(TopicRegistry)を添字とする配列で持ち、領域を再利用するため、
+ * 同じトピックへの2回目以降の更新では(メッセージ本体が以前より大きくならない限り)メモリ確保は発生しない。スレッドセーフではない
+ */
+class Conflator
+{
+public:
+    /**
+     * @brief メッセージを送信待ちの枠に格納します
+     *
+     * @param topic トピックのID
+     * @param payload メッセージ本体(枠にコピーする)
+     * @return true 送信待ちだった古いメッセージを上書きした
+     * @return false 新たに送信待ちになった
+     */
+    bool update(TopicId topic, std::string_view payload)
+    {
+        if (topic >= m_slots.size())
+        {
+            m_slots.resize(topic + 1);
+        }
+        Slot &slot = m_slots[topic];
+        if (!slot.isUsed)
+        {
+            slot.isUsed = true;
+            m_topicCount++;
+        }
+        slot.payload.assign(payload.data(), payload.size());
+        m_stats.updates++;
+        if (slot.isPending)
+        {
+            m_stats.conflated++;
+            return true;
+        }
+        slot.isPending = true;
+        m_pending.push_back(topic);
+        return false;
+    }
+
+    /**
+     * @brief 送信待ちの全トピックの最新のメッセージを送信します
+     *
+     * @param send 送信する関数(引数はトピックのID、メッセージ本体)
+     * @return size_t 送信したメッセージ数
+     */
+    template <class Send>
+    size_t flush(Send &&send)
+    {
+        // 送信中にupdate()が呼ばれても、その更新は次回のflush()で送信する
+        m_flushing.swap(m_pending);
+        for (TopicId topic : m_flushing)
+        {
+            m_slots[topic].isPending = false;
+            send(topic, std::string_view(m_slots[topic].payload));
+        }
+        const size_t count = m_flushing.size();
+        m_flushing.clear();
+        m_stats.flushed += count;
+        if (count > 0)
+        {
+            m_stats.flushes++;
+        }
+        return count;
+    }
+
+    /**
+     * @brief 送信待ちのトピック数を返します
+     *
+     * @return size_t
+     */
+    size_t pending() const { return m_pending.size(); }
+
+    /**
+     * @brief 間引き処理の統計値を返します
+     *
+     * @return ConflationStats
+     */
+    ConflationStats stats() const
+    {
+        ConflationStats stats = m_stats;
+        stats.topics = m_topicCount;
+        stats.pending = m_pending.size();
+        return stats;
+    }
+
+private:
+    /**
+     * @brief トピックごとの送信待ちの枠
+     */
+    struct Slot
+    {
+        std::string payload;    //! 最新のメッセージ本体
+        bool isPending{false};  //! 送信待ちか
+        bool isUsed{false};     //! 一度でも更新されたか
+    };
+
+    std::vector<Slot> m_slots;        //! トピックのIDごとの枠
+    std::vector<TopicId> m_pending;   //! 送信待ちになった順のトピック
+    std::vector<TopicId> m_flushing;  //! flush()中に送信しているトピック
+    size_t m_topicCount{0};           //! 一度でも更新されたトピック数
+    ConflationStats m_stats;          //! 統計値(topics、pendingは参照時に設定する)
+};
+
+#endif // CONFLATOR_HPP_
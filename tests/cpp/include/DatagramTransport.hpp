@@ -0,0 +1,359 @@
+/**
+ * @file DatagramTransport.hpp
+ * @brief メッセージ単位で送受信するトランスポートの共通インターフェースの定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef DATAGRAM_TRANSPORT_HPP_
+#define DATAGRAM_TRANSPORT_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+using socket_t = SOCKET;
+#define CLOSE_SOCKET(s) closesocket(s)
+#define GET_ERROR() WSAGetLastError()
+#define INVALID_SOCK INVALID_SOCKET
+#define SOCK_ERR SOCKET_ERROR
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+using socket_t = int;
+#define CLOSE_SOCKET(s) close(s)
+#define GET_ERROR() errno
+#define INVALID_SOCK (-1)
+#define SOCK_ERR (-1)
+#endif
+
+// C++20のコルーチンが利用できる場合のみ、co_await用のAPI(AsyncLoop.hpp)を有効にする
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define UDP_HANDLER_HAS_COROUTINE 1
+#include <coroutine>
+class AsyncLoop;
+class AsyncReceive;
+class AsyncSend;
+#endif
+
+/**
+ * @brief カーネルが記録した送受信時刻
+ * @details CLOCK_REALTIME基準のため、system_clockの現在時刻と比較できる。取得できなかった場合は既定値(エポック)となる
+ */
+using KernelTimestamp = std::chrono::system_clock::time_point;
+
+/**
+ * @brief 受信処理で再利用する固定長バッファの集合
+ * @details 連続した1つの領域を固定長のスロットに分割して使用する。
+ * 一度確保した領域は解放せずに再利用するため、受信処理のたびにメモリ確保は発生しない
+ */
+class BufferPool
+{
+public:
+    /**
+     * @brief 新しいバッファプールを構成します
+     *
+     * @param slotSize スロット1件あたりのバイト数
+     */
+    explicit BufferPool(size_t slotSize) : m_slotSize(slotSize) {}
+
+    /**
+     * @brief 最低count件分のスロットを確保します
+     * @details 確保済みのスロット数で足りる場合は何もしない。
+     * 領域を拡張した場合は、それまでに返したスロットへのポインタは無効になる
+     * @param count 確保するスロット数
+     */
+    void reserve(size_t count)
+    {
+        if (count > capacity())
+        {
+            m_storage.resize(count * m_slotSize);
+        }
+    }
+    /**
+     * @brief i番目のスロットの先頭を返します
+     *
+     * @param i スロット番号
+     * @return char*
+     */
+    char *slot(size_t i) { return m_storage.data() + i * m_slotSize; }
+    size_t slotSize() const { return m_slotSize; }
+    size_t capacity() const { return m_storage.size() / m_slotSize; }
+
+private:
+    size_t m_slotSize;
+    std::vector<char> m_storage;
+};
+
+/**
+ * @brief 一括受信したデータグラム群を参照するためのビュー
+ * @details 各要素はトランスポート内部の受信バッファを指すため、次の受信処理を呼び出すまで有効
+ */
+class ReceiveBatch
+{
+public:
+    using const_iterator = std::vector<std::string_view>::const_iterator;
+
+    /**
+     * @brief 受信したデータグラム数を返します
+     *
+     * @return size_t
+     */
+    size_t size() const { return m_views.size(); }
+    /**
+     * @brief データグラムを1件も受信していないかを返します
+     *
+     * @return bool
+     */
+    bool empty() const { return m_views.empty(); }
+    const std::string_view &operator[](size_t i) const { return m_views[i]; }
+    const_iterator begin() const { return m_views.begin(); }
+    const_iterator end() const { return m_views.end(); }
+    /**
+     * @brief i番目のデータグラムをカーネルが受信した時刻を返します
+     * @details UdpOptions::rxTimestampingが無効な場合は既定値を返す
+     * @param i データグラムの位置
+     * @return KernelTimestamp
+     */
+    KernelTimestamp timestamp(size_t i) const { return i < m_timestamps.size() ? m_timestamps[i] : KernelTimestamp{}; }
+
+private:
+    friend class UdpHandler;
+    friend class UnixDatagramHandler;
+    std::vector<std::string_view> m_views;
+    std::vector<KernelTimestamp> m_timestamps;
+};
+
+/**
+ * @brief 一括送信するデータグラム群を保持するクラス
+ * @details 追加したペイロードは参照のみを保持するため、sendBatch()を呼び出すまで
+ * 呼び出し側でバッファを保持すること。送信後は各要素に送信結果が格納される
+ */
+class SendBatch
+{
+public:
+    /**
+     * @brief 送信するデータグラム1件分の情報と送信結果
+     */
+    struct Entry
+    {
+        std::string_view payload;         //! 送信するペイロード
+        std::optional<sockaddr_in> dest;  //! 送信先(未指定の場合はトランスポートの送信先。UDPのみ)
+        bool sent{false};                 //! 送信済みか
+        size_t sentBytes{0};              //! 送信したバイト数
+        int error{0};                     //! 送信失敗時のエラーコード
+    };
+    using const_iterator = std::vector<Entry>::const_iterator;
+
+    /**
+     * @brief 既定の送信先へ送るデータグラムを追加します
+     *
+     * @param payload ペイロード
+     */
+    void add(std::string_view payload)
+    {
+        m_entries.push_back(Entry{payload, std::nullopt});
+    }
+    /**
+     * @brief 送信先を指定してデータグラムを追加します
+     *
+     * @param payload ペイロード
+     * @param dest 送信先アドレス
+     */
+    void add(std::string_view payload, const sockaddr_in &dest)
+    {
+        m_entries.push_back(Entry{payload, dest});
+    }
+    /**
+     * @brief 追加したデータグラムをすべて破棄します
+     * @details 確保済みの領域は再利用される
+     */
+    void clear() { m_entries.clear(); }
+
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+    const Entry &operator[](size_t i) const { return m_entries[i]; }
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+
+private:
+    friend class UdpHandler;
+    friend class UnixDatagramHandler;
+    std::vector<Entry> m_entries;
+};
+
+/**
+ * @brief 一括送信の結果概要
+ */
+struct SendBatchResult
+{
+    size_t sentCount{0};   //! 送信できたデータグラム数
+    size_t failedCount{0}; //! 送信できなかったデータグラム数
+    int firstError{0};     //! 最初に発生したエラーコード
+
+    /**
+     * @brief すべてのデータグラムを送信できたかを返します
+     *
+     * @return bool
+     */
+    bool complete() const { return failedCount == 0; }
+};
+
+/**
+ * @brief UDPデータグラムの最大長(IPv4のペイロード上限65507バイトを含む64KiB)
+ */
+constexpr size_t kMaxDatagramSize = 64 * 1024;
+
+/**
+ * @brief メッセージの境界を保って送受信するトランスポートの共通インターフェース
+ * @details UDP(UdpHandler)とAF_UNIXソケット(UnixDatagramHandler)が実装する。
+ * MqttBridge、SendQueue、AsyncLoopはこのインターフェースを介して送受信するため、トランスポートに依存しない。
+ * 受信用と送信用の端点を別々に持ち、受信した領域は次の受信処理を呼び出すまで有効なビューとして返す
+ */
+class DatagramTransport
+{
+public:
+    virtual ~DatagramTransport() = default;
+
+    /**
+     * @brief データ受信処理
+     * @details メッセージを受信した場合は、受信したデータを返す。もし受信していない場合は、std::nulloptを返す
+     * @param timeoutMs タイムアウト時間[msec]
+     * @return std::optional<std::string>
+     */
+    std::optional<std::string> receive(int timeoutMs = 100)
+    {
+        auto view = receiveView(timeoutMs);
+        if (view)
+        {
+            return std::string(view.value());
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief データ受信処理(コピーなし)
+     * @details 戻り値は内部の受信バッファを参照し、次の受信処理を呼び出すまで有効
+     * @param timeoutMs タイムアウト時間[msec]
+     * @return std::optional<std::string_view> 受信したデータ(未受信の場合はstd::nullopt)
+     */
+    virtual std::optional<std::string_view> receiveView(int timeoutMs = 100) = 0;
+
+    /**
+     * @brief 受信キューに溜まっているメッセージをまとめて受信します
+     * @details 最初のメッセージをtimeoutMsまで待ち、以降は待たずに取り出せるだけ取り出す
+     * @param maxCount 1回で取り出す最大メッセージ数
+     * @param timeoutMs タイムアウト時間[msec](0の場合は待機しない)
+     * @return const ReceiveBatch& 受信したメッセージ群(次の受信処理を呼び出すまで有効)
+     */
+    virtual const ReceiveBatch &receiveBatch(size_t maxCount = 16, int timeoutMs = 100) = 0;
+
+    /**
+     * @brief メッセージを送信
+     *
+     * @param msg 送信するメッセージ
+     */
+    virtual void send(const std::string &msg) = 0;
+
+    /**
+     * @brief 複数の領域を連結して1つのメッセージとして送信
+     *
+     * @param parts 送信する領域の配列
+     * @param count 領域の数
+     * @return true 送信成功
+     * @return false 送信失敗
+     */
+    virtual bool sendGather(const std::string_view *parts, size_t count) = 0;
+
+    /**
+     * @brief 複数の領域を連結して1つのメッセージとして送信
+     *
+     * @param parts 送信する領域の並び
+     * @return true 送信成功
+     * @return false 送信失敗
+     */
+    bool sendGather(std::initializer_list<std::string_view> parts)
+    {
+        return sendGather(parts.begin(), parts.size());
+    }
+
+    /**
+     * @brief 複数のメッセージを一括送信
+     *
+     * @param batch 送信するメッセージ群(各要素に送信結果が格納される)
+     * @return SendBatchResult 送信結果の概要
+     */
+    virtual SendBatchResult sendBatch(SendBatch &batch) = 0;
+
+    /**
+     * @brief 複数の領域を連結して1つのメッセージとして送信(複数スレッドから同時に呼び出し可能)
+     * @details 呼び出し元スレッドごとに専用の接続済みソケットを使うため、スレッド間でロックを取らない。
+     * 他の送信処理とは別のソケットから送信するため、ペーシングや送信統計の対象外となる
+     * @param parts 送信する領域の配列
+     * @param count 領域の数
+     * @return true 送信成功
+     * @return false 送信失敗
+     */
+    virtual bool sendConcurrent(const std::string_view *parts, size_t count) = 0;
+
+    /**
+     * @brief 待機せずにメッセージを送信
+     *
+     * @param msg 送信するメッセージ
+     * @return int 0:送信成功、EAGAIN:送信バッファが満杯、それ以外:エラーコード
+     */
+    virtual int trySend(std::string_view msg) = 0;
+
+    /**
+     * @brief 受信イベントを待機するためのハンドルを返します
+     * @details EventReactorへの登録にはこのハンドルを使用すること
+     * @return socket_t
+     */
+    virtual socket_t eventHandle() const = 0;
+
+    /**
+     * @brief 送信ソケットを返します
+     * @details 送信可能イベントの待機に使用する
+     * @return socket_t
+     */
+    virtual socket_t sendSocket() const = 0;
+
+#ifdef UDP_HANDLER_HAS_COROUTINE
+    /**
+     * @brief メッセージを非同期に受信します(co_await用)
+     * @details 定義はAsyncLoop.hppにある。受信するまでコルーチンを中断し、スレッドを占有しない。
+     * 同じトランスポートで複数のコルーチンが待機した場合は、待機を開始した順に1件ずつ受け取る
+     * @param loop コルーチンを駆動するイベントループ
+     * @param timeoutMs タイムアウト時間[msec](負の場合は無期限)
+     * @return AsyncReceive co_awaitの結果はstd::optional<std::string>(タイムアウト時はstd::nullopt)
+     */
+    AsyncReceive async_receive(AsyncLoop &loop, int timeoutMs = -1);
+
+    /**
+     * @brief メッセージを非同期に送信します(co_await用)
+     * @details 定義はAsyncLoop.hppにある。送信バッファが満杯の場合は、送信可能になるまでコルーチンを中断する
+     * @param loop コルーチンを駆動するイベントループ
+     * @param payload 送信するメッセージ(co_awaitの完了まで有効であること)
+     * @return AsyncSend co_awaitの結果はint(0:送信成功、それ以外:エラーコード)
+     */
+    AsyncSend async_send(AsyncLoop &loop, std::string_view payload);
+#endif
+};
+
+#endif // DATAGRAM_TRANSPORT_HPP_
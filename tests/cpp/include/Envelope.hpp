@@ -0,0 +1,268 @@
+/**
+ * @file Envelope.hpp
+ * @brief 複数の小さなメッセージを1つのデータグラムにまとめるエンベロープ形式の定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef ENVELOPE_HPP_
+#define ENVELOPE_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief エンベロープの先頭を示す識別子
+ * @details トピックの先頭に現れない制御文字で始める
+ */
+constexpr std::string_view kEnvelopeMagic{"\x1f" "EN"};
+
+/**
+ * @brief エンベロープ内の各レコードの先頭のバイト数(トピック長2、メッセージ本体長2)
+ */
+constexpr size_t kEnvelopeRecordHeaderSize = 2 + 2;
+
+/**
+ * @brief メッセージをまとめて送信する際の構成オプション
+ */
+struct CoalesceOptions
+{
+    size_t maxDatagramSize{1400};           //! エンベロープの最大バイト数(経路MTUから28を引いた値以下)
+    std::chrono::microseconds maxDelay{1000}; //! 最初のメッセージをエンベロープに入れてから送信するまでの最大時間
+};
+
+/**
+ * @brief メッセージをまとめて送受信した統計値
+ */
+struct CoalesceStats
+{
+    uint64_t recordsCoalesced{0};   //! エンベロープに入れたメッセージ数
+    uint64_t envelopesSent{0};      //! 送信したエンベロープ数(メッセージが1件のみで通常の形式で送信したものを除く)
+    uint64_t singlesSent{0};        //! まとめる相手がなく、通常の形式で送信したメッセージ数
+    uint64_t flushedBySize{0};      //! 次のメッセージが収まらないため送信した回数
+    uint64_t flushedByDelay{0};     //! maxDelayを過ぎたため送信した回数
+    uint64_t flushedExplicitly{0};  //! flushEnvelope()またはflushDueEnvelope()の呼び出しで送信した回数
+    uint64_t envelopesReceived{0};  //! 受信したエンベロープ数
+    uint64_t recordsReceived{0};    //! 受信したエンベロープから取り出したメッセージ数
+    uint64_t malformedEnvelopes{0}; //! 形式が不正なため破棄したエンベロープ数
+};
+
+/**
+ * @brief データグラムがエンベロープかを返します
+ *
+ * @param datagram 受信したデータグラム
+ * @return bool
+ */
+inline bool isEnvelope(std::string_view datagram)
+{
+    return datagram.substr(0, kEnvelopeMagic.size()) == kEnvelopeMagic;
+}
+
+/**
+ * @brief エンベロープから各メッセージを取り出します
+ * @details 全てのレコードの長さを検証してから取り出すため、形式が不正な場合はどのメッセージも渡さない
+ * @param datagram 受信したエンベロープ
+ * @param func 各メッセージ(トピック、メッセージ本体)を受け取る関数
+ * @return size_t 取り出したメッセージ数(形式が不正な場合は0)
+ */
+template <class Func>
+size_t decodeEnvelope(std::string_view datagram, Func &&func)
+{
+    if (!isEnvelope(datagram))
+    {
+        return 0;
+    }
+    auto readLength = [](const char *p)
+    {
+        return (static_cast<size_t>(static_cast<unsigned char>(p[0])) << 8) | static_cast<unsigned char>(p[1]);
+    };
+    const std::string_view records = datagram.substr(kEnvelopeMagic.size());
+    size_t count = 0;
+    for (size_t pos = 0; pos < records.size(); ++count)
+    {
+        if (records.size() - pos < kEnvelopeRecordHeaderSize)
+        {
+            return 0;
+        }
+        const size_t length = kEnvelopeRecordHeaderSize + readLength(&records[pos]) + readLength(&records[pos + 2]);
+        if (records.size() - pos < length)
+        {
+            return 0;
+        }
+        pos += length;
+    }
+    for (size_t pos = 0; pos < records.size();)
+    {
+        const size_t topicSize = readLength(&records[pos]);
+        const size_t payloadSize = readLength(&records[pos + 2]);
+        pos += kEnvelopeRecordHeaderSize;
+        func(records.substr(pos, topicSize), records.substr(pos + topicSize, payloadSize));
+        pos += topicSize + payloadSize;
+    }
+    return count;
+}
+
+/**
+ * @brief 送信するメッセージをエンベロープにまとめるクラス
+ * @details 最大サイズ分の領域を最初に確保し、以降は再利用するため、メッセージの追加でメモリ確保は発生しない。
+ * スレッドセーフではない
+ */
+class EnvelopeBuilder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 新しいエンベロープを構成します
+     *
+     * @param options 構成オプション
+     */
+    explicit EnvelopeBuilder(const CoalesceOptions &options) : m_options(options)
+    {
+        if (options.maxDatagramSize <= kEnvelopeMagic.size() + kEnvelopeRecordHeaderSize)
+        {
+            throw std::invalid_argument("maxDatagramSize is too small for an envelope");
+        }
+        m_buffer.reserve(options.maxDatagramSize);
+        m_buffer.assign(kEnvelopeMagic);
+    }
+
+    /**
+     * @brief メッセージが単独でエンベロープに収まるかを返します
+     *
+     * @param topicSize トピックのバイト数
+     * @param payloadSize メッセージ本体のバイト数
+     * @return bool
+     */
+    bool fitsAlone(size_t topicSize, size_t payloadSize) const
+    {
+        return topicSize <= UINT16_MAX && payloadSize <= UINT16_MAX &&
+               kEnvelopeMagic.size() + recordSize(topicSize, payloadSize) <= m_options.maxDatagramSize;
+    }
+
+    /**
+     * @brief 現在のエンベロープにメッセージを追加できるかを返します
+     *
+     * @param topicSize トピックのバイト数
+     * @param payloadSize メッセージ本体のバイト数
+     * @return bool
+     */
+    bool fits(size_t topicSize, size_t payloadSize) const
+    {
+        return fitsAlone(topicSize, payloadSize) &&
+               m_buffer.size() + recordSize(topicSize, payloadSize) <= m_options.maxDatagramSize;
+    }
+
+    /**
+     * @brief メッセージを追加します(fits()で収まることを確認してから呼び出すこと)
+     * @details メッセージ本体は複数の領域を連結したものとして渡す。最初のメッセージの追加時に送信期限を設定する
+     * @param topic トピック
+     * @param parts メッセージ本体を構成する領域の配列
+     * @param count 領域の数
+     * @param now 現在時刻
+     */
+    void append(std::string_view topic, const std::string_view *parts, size_t count, Clock::time_point now = Clock::now())
+    {
+        size_t payloadSize = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            payloadSize += parts[i].size();
+        }
+        if (m_records == 0)
+        {
+            m_deadline = now + m_options.maxDelay;
+            m_firstTopic = topic.size();
+        }
+        const char header[kEnvelopeRecordHeaderSize] = {
+            static_cast<char>((topic.size() >> 8) & 0xff), static_cast<char>(topic.size() & 0xff),
+            static_cast<char>((payloadSize >> 8) & 0xff), static_cast<char>(payloadSize & 0xff)};
+        m_buffer.append(header, sizeof(header));
+        m_buffer.append(topic.data(), topic.size());
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_buffer.append(parts[i].data(), parts[i].size());
+        }
+        m_records++;
+    }
+
+    /**
+     * @brief エンベロープを空にします
+     *
+     */
+    void clear()
+    {
+        m_buffer.resize(kEnvelopeMagic.size());
+        m_records = 0;
+    }
+
+    /**
+     * @brief エンベロープ全体(識別子と全レコード)を返します
+     *
+     * @return std::string_view
+     */
+    std::string_view data() const { return m_buffer; }
+
+    /**
+     * @brief 唯一のメッセージのトピックを返します(1件のみの場合に通常の形式で送信するため)
+     *
+     * @return std::string_view
+     */
+    std::string_view firstTopic() const
+    {
+        return std::string_view(m_buffer).substr(kEnvelopeMagic.size() + kEnvelopeRecordHeaderSize, m_firstTopic);
+    }
+
+    /**
+     * @brief 唯一のメッセージの本体を返します(1件のみの場合に通常の形式で送信するため)
+     *
+     * @return std::string_view
+     */
+    std::string_view firstPayload() const
+    {
+        const size_t offset = kEnvelopeMagic.size() + kEnvelopeRecordHeaderSize + m_firstTopic;
+        return std::string_view(m_buffer).substr(offset, m_buffer.size() - offset);
+    }
+
+    /**
+     * @brief エンベロープ内のメッセージ数を返します
+     *
+     * @return size_t
+     */
+    size_t records() const { return m_records; }
+
+    /**
+     * @brief 送信期限を返します(メッセージが無い場合は無効)
+     *
+     * @return Clock::time_point
+     */
+    Clock::time_point deadline() const { return m_deadline; }
+
+    /**
+     * @brief 構成オプションを返します
+     *
+     * @return const CoalesceOptions&
+     */
+    const CoalesceOptions &options() const { return m_options; }
+
+private:
+    static size_t recordSize(size_t topicSize, size_t payloadSize)
+    {
+        return kEnvelopeRecordHeaderSize + topicSize + payloadSize;
+    }
+
+private:
+    CoalesceOptions m_options;
+    std::string m_buffer;          //! 識別子とレコード列
+    size_t m_records{0};           //! エンベロープ内のメッセージ数
+    size_t m_firstTopic{0};        //! 最初のメッセージのトピックのバイト数
+    Clock::time_point m_deadline;  //! 最初のメッセージを追加した時刻+maxDelay
+};
+
+#endif // ENVELOPE_HPP_
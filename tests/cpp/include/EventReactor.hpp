@@ -0,0 +1,418 @@
+/**
+ * @file EventReactor.hpp
+ * @brief ソケット受信とシミュレーション周期を駆動するイベントリアクタの定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている。
+ * Linuxではepollとtimerfdを使用し、それ以外の環境ではselect()と絶対時刻の期限で代替する
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef EVENT_REACTOR_HPP_
+#define EVENT_REACTOR_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "spdlog/spdlog.h"
+#include "UdpHandler.hpp"
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#endif
+
+/**
+ * @brief ソケットの受信可能・送信可能イベントと周期タイマを1つの待機点で処理するクラス
+ * @details 登録したソケットが受信可能(または送信可能)になると即座にハンドラを呼び出す。
+ * 周期タイマは絶対時刻の期限で発火するため、ハンドラの処理時間による周期のずれが蓄積しない
+ */
+class EventReactor
+{
+public:
+    using Handler = std::function<void()>;
+    /**
+     * @brief 周期タイマのハンドラ
+     * @details 引数は前回の呼び出しから経過した周期数(処理遅延で期限を逃した場合は2以上)
+     */
+    using TickHandler = std::function<void(uint64_t)>;
+
+    /**
+     * @brief 新しいイベントリアクタを構成します
+     *
+     */
+    EventReactor()
+    {
+#ifdef __linux__
+        m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epollFd == -1)
+        {
+            throw std::runtime_error("epoll_create1() failed: " + std::to_string(errno));
+        }
+#endif
+    }
+
+    /**
+     * @brief イベントリアクタを破棄します
+     * @details 登録されたソケットは閉じない(ソケットの所有者はUdpHandler)
+     */
+    ~EventReactor()
+    {
+#ifdef __linux__
+        if (m_timerFd != -1)
+        {
+            close(m_timerFd);
+        }
+        close(m_epollFd);
+#endif
+    }
+
+    EventReactor(const EventReactor &) = delete;
+    EventReactor &operator=(const EventReactor &) = delete;
+
+    /**
+     * @brief 受信可能イベントを監視するソケットを登録します
+     *
+     * @param sock 監視するソケット
+     * @param onReadable 受信可能になったときに呼び出すハンドラ
+     */
+    void addReader(socket_t sock, Handler onReadable)
+    {
+        const bool registered = isRegistered(sock);
+        m_readers[sock] = std::move(onReadable);
+        try
+        {
+            updateInterest(sock, registered);
+        }
+        catch (...)
+        {
+            m_readers.erase(sock);
+            throw;
+        }
+    }
+
+    /**
+     * @brief ソケットの受信可能イベントの監視を解除します
+     *
+     * @param sock 監視を解除するソケット
+     */
+    void removeReader(socket_t sock)
+    {
+        if (m_readers.erase(sock) == 0)
+        {
+            return;
+        }
+        updateInterest(sock, true);
+    }
+
+    /**
+     * @brief 送信可能イベントを監視するソケットを登録します
+     * @details 送信バッファに空きがある間は発火し続けるため、送信待ちが無くなったらremoveWriter()で解除すること
+     * @param sock 監視するソケット
+     * @param onWritable 送信可能になったときに呼び出すハンドラ
+     */
+    void addWriter(socket_t sock, Handler onWritable)
+    {
+        const bool registered = isRegistered(sock);
+        m_writers[sock] = std::move(onWritable);
+        try
+        {
+            updateInterest(sock, registered);
+        }
+        catch (...)
+        {
+            m_writers.erase(sock);
+            throw;
+        }
+    }
+
+    /**
+     * @brief ソケットの送信可能イベントの監視を解除します
+     *
+     * @param sock 監視を解除するソケット
+     */
+    void removeWriter(socket_t sock)
+    {
+        if (m_writers.erase(sock) == 0)
+        {
+            return;
+        }
+        updateInterest(sock, true);
+    }
+
+    /**
+     * @brief 周期タイマを設定します
+     * @details 最初の呼び出しは直ちに行い、以降は開始時刻+interval×nの絶対時刻で呼び出す
+     * @param interval 周期
+     * @param onTick 周期ごとに呼び出すハンドラ
+     */
+    void setTick(std::chrono::nanoseconds interval, TickHandler onTick)
+    {
+        if (interval.count() <= 0)
+        {
+            throw std::invalid_argument("tick interval must be positive");
+        }
+        m_tickInterval = interval;
+        m_onTick = std::move(onTick);
+#ifdef __linux__
+        if (m_timerFd == -1)
+        {
+            m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (m_timerFd == -1)
+            {
+                throw std::runtime_error("timerfd_create() failed: " + std::to_string(errno));
+            }
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = m_timerFd;
+            if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_timerFd, &ev) == -1)
+            {
+                throw std::runtime_error("epoll_ctl(ADD timerfd) failed: " + std::to_string(errno));
+            }
+        }
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        itimerspec spec{};
+        spec.it_value = now;
+        spec.it_interval.tv_sec = static_cast<time_t>(interval.count() / 1000000000);
+        spec.it_interval.tv_nsec = static_cast<long>(interval.count() % 1000000000);
+        if (timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &spec, nullptr) == -1)
+        {
+            throw std::runtime_error("timerfd_settime() failed: " + std::to_string(errno));
+        }
+#else
+        m_nextTick = std::chrono::steady_clock::now();
+#endif
+    }
+
+    /**
+     * @brief イベントを1回待機して処理します
+     *
+     * @param timeoutMs 最大待機時間[msec]
+     * @return true 待機が正常に終了した(タイムアウト、シグナルによる中断を含む)
+     * @return false 待機処理でエラーが発生した
+     */
+    bool runOnce(int timeoutMs)
+    {
+#ifdef __linux__
+        epoll_event events[kMaxEvents];
+        int count = epoll_wait(m_epollFd, events, kMaxEvents, timeoutMs);
+        if (count == -1)
+        {
+            if (errno == EINTR)
+            {
+                return true;
+            }
+            spdlog::error("epoll_wait() failed: " + std::to_string(errno));
+            return false;
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            const int fd = events[i].data.fd;
+            if (fd == m_timerFd)
+            {
+                uint64_t expirations = 0;
+                if (read(m_timerFd, &expirations, sizeof(expirations)) == sizeof(expirations) && expirations > 0 && m_onTick)
+                {
+                    m_onTick(expirations);
+                }
+                continue;
+            }
+            // ハンドラ内で登録解除された場合に備えて毎回検索する
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+            {
+                dispatch(m_readers, fd);
+            }
+            if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+            {
+                dispatch(m_writers, fd);
+            }
+        }
+        return true;
+#else
+        using namespace std::chrono;
+        if (m_onTick)
+        {
+            auto now = steady_clock::now();
+            if (now < m_nextTick)
+            {
+                auto untilTick = duration_cast<milliseconds>(m_nextTick - now).count() + 1;
+                timeoutMs = timeoutMs < 0 ? static_cast<int>(untilTick) : std::min<int>(timeoutMs, static_cast<int>(untilTick));
+            }
+            else
+            {
+                timeoutMs = 0;
+            }
+        }
+        const bool idle = m_readers.empty() && m_writers.empty();
+        if (idle)
+        {
+            // 監視対象が無い場合、select()はエラーとなる環境があるため待機のみ行う
+            std::this_thread::sleep_for(milliseconds(timeoutMs < 0 ? 0 : timeoutMs));
+        }
+        fd_set readfds;
+        fd_set writefds;
+        FD_ZERO(&readfds);
+        FD_ZERO(&writefds);
+        socket_t maxSock = 0;
+        for (const auto &reader : m_readers)
+        {
+            FD_SET(reader.first, &readfds);
+            maxSock = std::max(maxSock, reader.first);
+        }
+        for (const auto &writer : m_writers)
+        {
+            FD_SET(writer.first, &writefds);
+            maxSock = std::max(maxSock, writer.first);
+        }
+        timeval tv;
+        tv.tv_sec = timeoutMs / 1000;
+        tv.tv_usec = (timeoutMs % 1000) * 1000;
+        int sel = idle ? 0 : select(static_cast<int>(maxSock + 1), &readfds, &writefds, nullptr, timeoutMs < 0 ? nullptr : &tv);
+        if (sel == SOCK_ERR)
+        {
+            if (GET_ERROR() == EINTR)
+            {
+                return true;
+            }
+            spdlog::error("select() failed: " + std::to_string(GET_ERROR()));
+            return false;
+        }
+        if (sel > 0)
+        {
+            std::vector<socket_t> readable;
+            std::vector<socket_t> writable;
+            for (const auto &reader : m_readers)
+            {
+                if (FD_ISSET(reader.first, &readfds))
+                {
+                    readable.push_back(reader.first);
+                }
+            }
+            for (const auto &writer : m_writers)
+            {
+                if (FD_ISSET(writer.first, &writefds))
+                {
+                    writable.push_back(writer.first);
+                }
+            }
+            for (auto sock : readable)
+            {
+                dispatch(m_readers, sock);
+            }
+            for (auto sock : writable)
+            {
+                dispatch(m_writers, sock);
+            }
+        }
+        if (m_onTick)
+        {
+            auto now = steady_clock::now();
+            if (now >= m_nextTick)
+            {
+                uint64_t expirations = static_cast<uint64_t>((now - m_nextTick) / m_tickInterval) + 1;
+                m_nextTick += m_tickInterval * expirations;
+                m_onTick(expirations);
+            }
+        }
+        return true;
+#endif
+    }
+
+    /**
+     * @brief 停止フラグが立つまでイベントを処理し続けます
+     *
+     * @param stopFlag 停止フラグ
+     * @param maxWaitMs 停止フラグを確認する最大間隔[msec]
+     */
+    void run(const std::atomic<bool> &stopFlag, int maxWaitMs = 100)
+    {
+        while (!stopFlag.load())
+        {
+            if (!runOnce(maxWaitMs))
+            {
+                break;
+            }
+        }
+    }
+
+private:
+    /**
+     * @brief ソケットに対応するハンドラを呼び出します
+     * @details 直前のハンドラ内で登録解除された場合は呼び出さない
+     * @param handlers ハンドラの登録先
+     * @param sock イベントが発生したソケット
+     */
+    static void dispatch(std::unordered_map<socket_t, Handler> &handlers, socket_t sock)
+    {
+        auto it = handlers.find(sock);
+        if (it != handlers.end())
+        {
+            it->second();
+        }
+    }
+
+    /**
+     * @brief ソケットが受信または送信の監視対象かを返します
+     *
+     * @param sock 対象ソケット
+     * @return bool
+     */
+    bool isRegistered(socket_t sock) const
+    {
+        return m_readers.count(sock) > 0 || m_writers.count(sock) > 0;
+    }
+
+    /**
+     * @brief 登録状況に合わせてソケットの監視イベントを更新します
+     *
+     * @param sock 対象ソケット
+     * @param registered 更新前にepollへ登録済みだったか
+     */
+    void updateInterest(socket_t sock, bool registered)
+    {
+#ifdef __linux__
+        epoll_event ev{};
+        ev.events = (m_readers.count(sock) ? EPOLLIN : 0u) | (m_writers.count(sock) ? EPOLLOUT : 0u);
+        ev.data.fd = sock;
+        if (ev.events == 0)
+        {
+            if (epoll_ctl(m_epollFd, EPOLL_CTL_DEL, sock, nullptr) == -1)
+            {
+                spdlog::warn("epoll_ctl(DEL) failed: " + std::to_string(errno));
+            }
+            return;
+        }
+        if (epoll_ctl(m_epollFd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, sock, &ev) == -1)
+        {
+            throw std::runtime_error(std::string("epoll_ctl(") + (registered ? "MOD" : "ADD") + ") failed: " + std::to_string(errno));
+        }
+#else
+        (void)sock;
+        (void)registered;
+#endif
+    }
+
+private:
+    static constexpr int kMaxEvents = 16; //! 1回の待機で処理する最大イベント数
+
+    std::unordered_map<socket_t, Handler> m_readers; //! 受信可能イベントを監視中のソケットとハンドラ
+    std::unordered_map<socket_t, Handler> m_writers; //! 送信可能イベントを監視中のソケットとハンドラ
+    TickHandler m_onTick;                            //! 周期タイマのハンドラ
+    std::chrono::nanoseconds m_tickInterval{0};      //! 周期タイマの周期
+#ifdef __linux__
+    int m_epollFd{-1}; //! epollインスタンス
+    int m_timerFd{-1}; //! 周期タイマ
+#else
+    std::chrono::steady_clock::time_point m_nextTick; //! 次の周期タイマの期限
+#endif
+};
+
+#endif // EVENT_REACTOR_HPP_
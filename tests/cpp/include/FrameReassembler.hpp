@@ -0,0 +1,387 @@
+/**
+ * @file FrameReassembler.hpp
+ * @brief データグラムに収まらないフレームの分割ヘッダと再構成処理の定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef FRAME_REASSEMBLER_HPP_
+#define FRAME_REASSEMBLER_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 分割ヘッダの先頭を示す識別子
+ * @details メッセージ本体(JSON)の先頭に現れない制御文字で始める
+ */
+constexpr std::string_view kFragmentMagic{"\x1f" "FR"};
+
+/**
+ * @brief 分割ヘッダのバイト数(識別子、送信元番号4、フレーム番号4、断片番号2、断片数2、フレーム長4、断片の位置4)
+ */
+constexpr size_t kFragmentHeaderSize = 3 + 4 + 4 + 2 + 2 + 4 + 4;
+
+/**
+ * @brief 分割したフレームの各断片の先頭に付加するヘッダ
+ * @details 数値はネットワークバイトオーダ(ビッグエンディアン)で格納する
+ */
+struct FragmentHeader
+{
+    uint32_t senderId{0};   //! 送信側が起動ごとに乱数で選ぶ番号(再起動でフレーム番号が戻っても区別するため)
+    uint32_t frameId{0};    //! 送信側で割り当てたフレーム番号
+    uint16_t index{0};      //! 断片番号(0始まり)
+    uint16_t count{0};      //! フレームの断片数
+    uint32_t frameSize{0};  //! 分割前のフレームのバイト数
+    uint32_t offset{0};     //! 断片のフレーム内の位置[byte]
+};
+
+/**
+ * @brief 分割ヘッダをバッファに書き込みます
+ *
+ * @param out 書き込み先(kFragmentHeaderSizeバイト)
+ * @param header 分割ヘッダ
+ * @return std::string_view 書き込んだヘッダ
+ */
+inline std::string_view encodeFragmentHeader(char *out, const FragmentHeader &header)
+{
+    std::memcpy(out, kFragmentMagic.data(), kFragmentMagic.size());
+    char *p = out + kFragmentMagic.size();
+    auto put = [&p](uint32_t value, int bytes)
+    {
+        for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8)
+        {
+            *p++ = static_cast<char>((value >> shift) & 0xff);
+        }
+    };
+    put(header.senderId, 4);
+    put(header.frameId, 4);
+    put(header.index, 2);
+    put(header.count, 2);
+    put(header.frameSize, 4);
+    put(header.offset, 4);
+    return std::string_view(out, kFragmentHeaderSize);
+}
+
+/**
+ * @brief メッセージ本体の先頭の分割ヘッダを読み取り、取り除きます
+ *
+ * @param payload メッセージ本体(ヘッダがある場合は断片の範囲に更新する)
+ * @return std::optional<FragmentHeader> 分割ヘッダ(無い場合はstd::nullopt)
+ */
+inline std::optional<FragmentHeader> decodeFragmentHeader(std::string_view &payload)
+{
+    if (payload.size() < kFragmentHeaderSize || payload.substr(0, kFragmentMagic.size()) != kFragmentMagic)
+    {
+        return std::nullopt;
+    }
+    const char *p = payload.data() + kFragmentMagic.size();
+    auto get = [&p](int bytes)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+        {
+            value = (value << 8) | static_cast<unsigned char>(*p++);
+        }
+        return value;
+    };
+    FragmentHeader header;
+    header.senderId = get(4);
+    header.frameId = get(4);
+    header.index = static_cast<uint16_t>(get(2));
+    header.count = static_cast<uint16_t>(get(2));
+    header.frameSize = get(4);
+    header.offset = get(4);
+    payload.remove_prefix(kFragmentHeaderSize);
+    return header;
+}
+
+/**
+ * @brief フレーム分割・再構成の構成オプション
+ */
+struct FragmentOptions
+{
+    size_t maxDatagramSize{1400};                   //! 分割後のデータグラムの最大バイト数(トピックとヘッダを含む。経路MTUから28を引いた値以下)
+    std::chrono::milliseconds reassemblyTimeout{500}; //! 最初の断片の受信から、全断片が揃うまで待つ最大時間
+    size_t maxPendingFrames{64};                    //! 同時に再構成するフレームの最大数(超えた場合は最も古いものを破棄する)
+    size_t maxFrameSize{16 * 1024 * 1024};          //! 再構成するフレームの最大バイト数(超える断片は不正として破棄する)
+    size_t maxPendingBytes{64 * 1024 * 1024};       //! 再構成中のフレームの合計の最大バイト数(超える場合は最も古いものから破棄する)
+};
+
+/**
+ * @brief フレーム分割・再構成の統計値
+ */
+struct FragmentStats
+{
+    uint64_t framesSplit{0};         //! 分割して送信したフレーム数
+    uint64_t fragmentsSent{0};       //! 送信した断片数
+    uint64_t fragmentsReceived{0};   //! 受信した断片数
+    uint64_t framesReassembled{0};   //! 再構成できたフレーム数
+    uint64_t framesIncomplete{0};    //! 断片が揃わずに破棄したフレーム数(タイムアウトまたは同時再構成数の超過)
+    uint64_t duplicateFragments{0};  //! 重複して受信した断片数
+    uint64_t malformedFragments{0};  //! ヘッダが不正なため破棄した断片数
+};
+
+/**
+ * @brief 断片からフレームを再構成するクラス
+ * @details トピック、送信元番号、フレーム番号の組ごとに、分割前の長さの領域を確保して各断片を位置どおりに書き込む。
+ * 各断片の位置は断片番号と断片の長さ(最後の断片以外は同じ長さ)に一致する必要があり、
+ * 重なる断片や長さの合計がフレーム長と一致しない断片は不正として破棄する。
+ * 一定時間内に全断片が揃わないフレームは破棄して数える。タイムアウトの確認は断片の受信時に行う。
+ * 確保する領域の合計はmaxPendingBytesまでに抑える。スレッドセーフではない
+ */
+class FrameReassembler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 新しい再構成処理を構成します
+     *
+     * @param options 構成オプション
+     * @param stats 統計値の格納先
+     */
+    FrameReassembler(const FragmentOptions &options, FragmentStats &stats) : m_options(options), m_stats(stats) {}
+
+    /**
+     * @brief 断片を1件取り込みます
+     * @details 戻り値は、次にrelease()を呼び出すまで有効
+     * @param topic トピック
+     * @param header 断片の分割ヘッダ
+     * @param fragment 断片の本体
+     * @param now 現在時刻
+     * @return std::optional<std::string_view> フレームが揃った場合は再構成したフレーム
+     */
+    std::optional<std::string_view> add(std::string_view topic, const FragmentHeader &header, std::string_view fragment,
+                                        Clock::time_point now = Clock::now())
+    {
+        m_stats.fragmentsReceived++;
+        expire(now);
+        const auto chunkSize = impliedChunkSize(header, fragment.size());
+        if (!chunkSize || header.frameSize > m_options.maxFrameSize || header.frameSize > m_options.maxPendingBytes)
+        {
+            m_stats.malformedFragments++;
+            return std::nullopt;
+        }
+
+        const uint64_t frameKey = (static_cast<uint64_t>(header.senderId) << 32) | header.frameId;
+        auto it = m_pending.find(std::make_pair(topic, frameKey));
+        if (it == m_pending.end())
+        {
+            if (m_pending.size() >= m_options.maxPendingFrames)
+            {
+                evictOldest();
+            }
+            while (!m_pending.empty() && m_pendingBytes + header.frameSize > m_options.maxPendingBytes)
+            {
+                evictOldest();
+            }
+            Pending pending;
+            pending.data.resize(header.frameSize);
+            pending.received.assign(header.count, false);
+            pending.chunkSize = *chunkSize;
+            pending.deadline = now + m_options.reassemblyTimeout;
+            it = m_pending.emplace(Key(std::string(topic), frameKey), std::move(pending)).first;
+            m_pendingBytes += header.frameSize;
+        }
+        Pending &pending = it->second;
+        if (pending.received.size() != header.count || pending.data.size() != header.frameSize ||
+            pending.chunkSize != *chunkSize)
+        {
+            m_stats.malformedFragments++;
+            return std::nullopt;
+        }
+        if (pending.received[header.index])
+        {
+            m_stats.duplicateFragments++;
+            return std::nullopt;
+        }
+        pending.received[header.index] = true;
+        pending.receivedCount++;
+        pending.receivedBytes += fragment.size();
+        std::memcpy(&pending.data[header.offset], fragment.data(), fragment.size());
+        if (pending.receivedCount < header.count)
+        {
+            return std::nullopt;
+        }
+        if (pending.receivedBytes != header.frameSize)
+        {
+            m_stats.malformedFragments++;
+            erase(it);
+            m_stats.framesIncomplete++;
+            return std::nullopt;
+        }
+        m_pendingBytes -= pending.data.size();
+        m_completed.push_back(std::move(pending.data));
+        m_pending.erase(it);
+        m_stats.framesReassembled++;
+        return std::string_view(m_completed.back());
+    }
+
+    /**
+     * @brief 再構成して返したフレームの領域を解放します
+     * @details 受信処理の先頭で呼び出す
+     */
+    void release() { m_completed.clear(); }
+
+    /**
+     * @brief 期限を過ぎた再構成中のフレームを破棄します
+     *
+     * @param now 現在時刻
+     */
+    void expire(Clock::time_point now = Clock::now())
+    {
+        for (auto it = m_pending.begin(); it != m_pending.end();)
+        {
+            if (it->second.deadline <= now)
+            {
+                it = erase(it);
+                m_stats.framesIncomplete++;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    /**
+     * @brief 再構成中のフレーム数を返します
+     *
+     * @return size_t
+     */
+    size_t pending() const { return m_pending.size(); }
+
+    /**
+     * @brief 再構成中のフレームの合計バイト数を返します
+     *
+     * @return size_t
+     */
+    size_t pendingBytes() const { return m_pendingBytes; }
+
+private:
+    //! トピックと、送信元番号(上位32bit)・フレーム番号(下位32bit)の組
+    using Key = std::pair<std::string, uint64_t>;
+
+    /**
+     * @brief 再構成中のフレーム
+     */
+    struct Pending
+    {
+        std::string data;             //! 再構成中のフレーム
+        std::vector<bool> received;   //! 断片ごとの受信状況
+        size_t receivedCount{0};      //! 受信した断片数
+        size_t receivedBytes{0};      //! 受信した断片の合計バイト数
+        size_t chunkSize{0};          //! 最後の断片以外の断片のバイト数
+        Clock::time_point deadline;   //! 全断片が揃うまでの期限
+    };
+
+    /**
+     * @brief 分割ヘッダと断片の長さから、最後の断片以外の断片のバイト数を求めます
+     * @details 送信側はフレームを先頭から同じ長さで区切るため、断片の位置は断片番号×その長さとなり、
+     * 最後の断片はフレームの末尾で終わる。これに合わない断片は不正とする
+     * @param header 断片の分割ヘッダ
+     * @param size 断片の本体のバイト数
+     * @return std::optional<size_t> 断片のバイト数(不正な場合はstd::nullopt)
+     */
+    static std::optional<size_t> impliedChunkSize(const FragmentHeader &header, size_t size)
+    {
+        if (header.count == 0 || header.index >= header.count ||
+            static_cast<uint64_t>(header.offset) + size > header.frameSize)
+        {
+            return std::nullopt;
+        }
+        if (header.index + 1 < header.count)
+        {
+            if (size == 0 || static_cast<uint64_t>(header.index) * size != header.offset)
+            {
+                return std::nullopt;
+            }
+            return size;
+        }
+        if (header.offset + size != header.frameSize)
+        {
+            return std::nullopt;
+        }
+        if (header.index == 0)
+        {
+            // 分割されていないフレーム
+            return header.offset == 0 ? std::optional<size_t>(header.frameSize) : std::nullopt;
+        }
+        const size_t chunk = header.offset / header.index;
+        if (chunk == 0 || chunk * header.index != header.offset || size == 0 || size > chunk)
+        {
+            return std::nullopt;
+        }
+        return chunk;
+    }
+
+    /**
+     * @brief 再構成中のフレームを削除します
+     *
+     * @param it 削除するフレーム
+     * @return 次の要素
+     */
+    template <class Iterator>
+    Iterator erase(Iterator it)
+    {
+        m_pendingBytes -= it->second.data.size();
+        return m_pending.erase(it);
+    }
+
+    /**
+     * @brief 期限が最も近い再構成中のフレームを破棄します
+     *
+     */
+    void evictOldest()
+    {
+        auto oldest = m_pending.begin();
+        for (auto it = m_pending.begin(); it != m_pending.end(); ++it)
+        {
+            if (it->second.deadline < oldest->second.deadline)
+            {
+                oldest = it;
+            }
+        }
+        if (oldest != m_pending.end())
+        {
+            erase(oldest);
+            m_stats.framesIncomplete++;
+        }
+    }
+
+    /**
+     * @brief トピックを複製せずに検索するための比較関数
+     */
+    struct KeyLess
+    {
+        using is_transparent = void;
+        template <class A, class B>
+        bool operator()(const A &a, const B &b) const
+        {
+            return std::string_view(a.first) < std::string_view(b.first) ||
+                   (std::string_view(a.first) == std::string_view(b.first) && a.second < b.second);
+        }
+    };
+
+private:
+    FragmentOptions m_options;
+    FragmentStats &m_stats;
+    std::map<Key, Pending, KeyLess> m_pending; //! トピック、送信元番号、フレーム番号ごとの再構成中のフレーム
+    size_t m_pendingBytes{0};                  //! 再構成中のフレームの合計バイト数
+    std::deque<std::string> m_completed;       //! 再構成して返したフレーム
+};
+
+#endif // FRAME_REASSEMBLER_HPP_
@@ -0,0 +1,747 @@
+/**
+ * @file IoUring.hpp
+ * @brief UdpHandlerのio_uringバックエンドの定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている。
+ * liburingには依存せず、カーネルヘッダ<linux/io_uring.h>とシステムコールのみで実装する。
+ * 受信はマルチショットrecvmsgと提供バッファリング(カーネル6.0以降)、送信はsendmsgの一括投入を用いる
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef IO_URING_HPP_
+#define IO_URING_HPP_
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define UDP_HANDLER_HAS_IO_URING 1
+#endif
+#endif
+
+#ifdef UDP_HANDLER_HAS_IO_URING
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @brief io_uringのリング1組(投入キューと完了キュー)を管理するクラス
+ *
+ */
+class IoUringRing
+{
+public:
+    /**
+     * @brief 新しいリングを構成します
+     * @details カーネルがio_uringに対応していない、または無効化されている場合はstd::system_errorを送出する
+     * @param entries 投入キューのエントリ数
+     */
+    explicit IoUringRing(unsigned entries)
+    {
+        io_uring_params params{};
+        m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (m_fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "io_uring_setup()");
+        }
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap)
+        {
+            m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+        }
+        m_sqRing = mapRing(m_sqRingSize, IORING_OFF_SQ_RING);
+        m_cqRing = singleMmap ? m_sqRing : mapRing(m_cqRingSize, IORING_OFF_CQ_RING);
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = static_cast<io_uring_sqe *>(mapRing(m_sqesSize, IORING_OFF_SQES));
+
+        auto *sq = static_cast<char *>(m_sqRing);
+        m_sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        m_sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        m_sqEntries = params.sq_entries;
+        m_sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        auto *cq = static_cast<char *>(m_cqRing);
+        m_cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        m_sqeTail = m_sqeHead = *m_sqTail;
+    }
+
+    /**
+     * @brief リングを破棄します
+     *
+     */
+    ~IoUringRing()
+    {
+        release();
+    }
+
+    IoUringRing(const IoUringRing &) = delete;
+    IoUringRing &operator=(const IoUringRing &) = delete;
+
+    /**
+     * @brief 空きの投入エントリを取得します
+     *
+     * @return io_uring_sqe* ゼロクリア済みのエントリ(投入キューが満杯の場合はnullptr)
+     */
+    io_uring_sqe *getSqe()
+    {
+        if (m_sqeTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+        {
+            return nullptr;
+        }
+        io_uring_sqe *sqe = &m_sqes[m_sqeTail & m_sqMask];
+        m_sqeTail++;
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    /**
+     * @brief 取得済みの投入エントリをカーネルへ投入します
+     *
+     * @param waitCount 完了を待つエントリ数(0の場合は待たない)
+     * @return int 投入したエントリ数(エラーの場合は-errno)
+     */
+    int submit(unsigned waitCount = 0)
+    {
+        const unsigned count = m_sqeTail - m_sqeHead;
+        for (unsigned i = m_sqeHead; i != m_sqeTail; ++i)
+        {
+            m_sqArray[i & m_sqMask] = i & m_sqMask;
+        }
+        __atomic_store_n(m_sqTail, m_sqeTail, __ATOMIC_RELEASE);
+        m_sqeHead = m_sqeTail;
+        for (;;)
+        {
+            long ret = syscall(__NR_io_uring_enter, m_fd, count, waitCount,
+                               waitCount > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (ret >= 0)
+            {
+                return static_cast<int>(ret);
+            }
+            if (errno != EINTR)
+            {
+                return -errno;
+            }
+        }
+    }
+
+    /**
+     * @brief 完了キューの先頭エントリを参照します
+     *
+     * @return io_uring_cqe* 完了エントリ(完了キューが空の場合はnullptr)
+     */
+    io_uring_cqe *peekCqe()
+    {
+        const unsigned head = *m_cqHead;
+        if (head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE))
+        {
+            return nullptr;
+        }
+        return &m_cqes[head & m_cqMask];
+    }
+
+    /**
+     * @brief 完了キューの先頭エントリを処理済みにします
+     *
+     */
+    void cqeSeen()
+    {
+        __atomic_store_n(m_cqHead, *m_cqHead + 1, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * @brief 完了エントリが届くまで待機します
+     * @details リングのファイル記述子は完了キューが空でない間、読み込み可能となる
+     * @param timeoutMs タイムアウト時間[msec]
+     * @return true 完了エントリあり
+     * @return false タイムアウト
+     */
+    bool waitCqe(int timeoutMs)
+    {
+        if (peekCqe() != nullptr)
+        {
+            return true;
+        }
+        pollfd pfd{m_fd, POLLIN, 0};
+        return poll(&pfd, 1, timeoutMs) > 0 && peekCqe() != nullptr;
+    }
+
+    /**
+     * @brief リングのファイル記述子を返します
+     *
+     * @return int
+     */
+    int fd() const { return m_fd; }
+
+private:
+    /**
+     * @brief リングの共有領域をマップします
+     * @details 失敗した場合は確保済みの資源を解放してstd::system_errorを送出する
+     * @param size マップするサイズ
+     * @param offset マップ対象を示すオフセット(IORING_OFF_*)
+     * @return void* マップした領域
+     */
+    void *mapRing(size_t size, off_t offset)
+    {
+        void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+        if (ptr == MAP_FAILED)
+        {
+            int err = errno;
+            release();
+            throw std::system_error(err, std::generic_category(), "mmap(io_uring)");
+        }
+        return ptr;
+    }
+
+    /**
+     * @brief マップした領域とファイル記述子を解放します
+     *
+     */
+    void release()
+    {
+        if (m_sqes != nullptr)
+        {
+            munmap(m_sqes, m_sqesSize);
+            m_sqes = nullptr;
+        }
+        if (m_cqRing != nullptr && m_cqRing != m_sqRing)
+        {
+            munmap(m_cqRing, m_cqRingSize);
+        }
+        m_cqRing = nullptr;
+        if (m_sqRing != nullptr)
+        {
+            munmap(m_sqRing, m_sqRingSize);
+            m_sqRing = nullptr;
+        }
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+private:
+    int m_fd{-1};
+    void *m_sqRing{nullptr};
+    void *m_cqRing{nullptr};
+    io_uring_sqe *m_sqes{nullptr};
+    size_t m_sqRingSize{0};
+    size_t m_cqRingSize{0};
+    size_t m_sqesSize{0};
+    unsigned *m_sqHead{nullptr};
+    unsigned *m_sqTail{nullptr};
+    unsigned *m_sqArray{nullptr};
+    unsigned m_sqMask{0};
+    unsigned m_sqEntries{0};
+    unsigned *m_cqHead{nullptr};
+    unsigned *m_cqTail{nullptr};
+    unsigned m_cqMask{0};
+    io_uring_cqe *m_cqes{nullptr};
+    unsigned m_sqeTail{0}; //! アプリケーション側で取得済みの投入エントリの末尾
+    unsigned m_sqeHead{0}; //! カーネルへ未投入の投入エントリの先頭
+};
+
+/**
+ * @brief マルチショットrecvmsgと提供バッファリングによる受信処理
+ * @details 受信バッファはカーネルに登録したバッファリングから供給され、
+ * 1回の投入でソケットが閉じられるまで(またはバッファが尽きるまで)受信し続ける。
+ * 受信したデータグラムのバッファはrecycle()を呼び出すまでアプリケーションが保持する。
+ * バッファリングを登録できない(または機能しない)カーネルでは、IORING_OP_PROVIDE_BUFFERSによる
+ * 従来方式の提供バッファへ切り替える
+ */
+class IoUringReceiver
+{
+public:
+    /**
+     * @brief 受信したデータグラム1件分の情報
+     */
+    struct Datagram
+    {
+        msghdr header; //! 補助データと受信フラグを格納したメッセージヘッダ
+        char *data;    //! ペイロードの先頭
+        size_t length; //! 切り詰め前のペイロード長
+    };
+
+    /**
+     * @brief 新しい受信処理を構成します
+     *
+     * @param sock 受信ソケット
+     * @param payloadSize データグラム1件あたりのペイロード用バッファサイズ
+     * @param controlSize データグラム1件あたりの補助データ用バッファサイズ
+     * @param bufferCount 登録するバッファ数(2のべき乗に切り上げる)
+     * @param entries 投入キューのエントリ数
+     */
+    IoUringReceiver(int sock, size_t payloadSize, size_t controlSize, size_t bufferCount, unsigned entries)
+        : m_ring(entries), m_sock(sock), m_controlSize(controlSize)
+    {
+        m_bufferCount = 1;
+        while (m_bufferCount < bufferCount && m_bufferCount < kMaxBuffers)
+        {
+            m_bufferCount <<= 1;
+        }
+        m_bufferSize = sizeof(io_uring_recvmsg_out) + controlSize + payloadSize;
+        m_buffers.resize(m_bufferCount * m_bufferSize);
+        m_msgTemplate.msg_controllen = controlSize;
+
+        if (!registerBufferRing())
+        {
+            provideLegacy(0, m_bufferCount);
+        }
+        arm();
+        checkArmed();
+    }
+
+    IoUringReceiver(const IoUringReceiver &) = delete;
+    IoUringReceiver &operator=(const IoUringReceiver &) = delete;
+
+    /**
+     * @brief 前回reap()で返したバッファをカーネルへ戻します
+     *
+     */
+    void recycle()
+    {
+        if (m_inUse.empty())
+        {
+            return;
+        }
+        if (m_bufRing.get() != nullptr)
+        {
+            for (size_t i = 0; i < m_inUse.size(); ++i)
+            {
+                provideRing(static_cast<uint16_t>(m_bufTail + i), m_inUse[i]);
+            }
+            m_bufTail = static_cast<uint16_t>(m_bufTail + m_inUse.size());
+            __atomic_store_n(&m_bufRing->tail, m_bufTail, __ATOMIC_RELEASE);
+        }
+        else
+        {
+            for (auto bid : m_inUse)
+            {
+                provideLegacy(bid, 1, false);
+            }
+        }
+        m_inUse.clear();
+        if (!m_armed)
+        {
+            arm();
+        }
+        else if (m_bufRing.get() == nullptr)
+        {
+            m_ring.submit();
+        }
+    }
+
+    /**
+     * @brief 完了したデータグラムを取り出します
+     * @details 取り出したデータグラムのバッファは、次にrecycle()を呼び出すまで有効
+     * @param maxCount 取り出す最大件数
+     * @param timeoutMs 完了エントリが無い場合の最大待機時間[msec]
+     * @param out 取り出したデータグラムの格納先(末尾に追加する)
+     * @return int 0:正常、負値:recvmsgが失敗した(-errno)。マルチショットrecvmsgは再投入するため、受信は継続できる
+     */
+    int reap(size_t maxCount, int timeoutMs, std::vector<Datagram> &out)
+    {
+        if (timeoutMs != 0 && !m_ring.waitCqe(timeoutMs))
+        {
+            return 0;
+        }
+        int error = 0;
+        size_t count = 0;
+        while (count < maxCount)
+        {
+            io_uring_cqe *cqe = m_ring.peekCqe();
+            if (cqe == nullptr)
+            {
+                break;
+            }
+            const int res = cqe->res;
+            const unsigned flags = cqe->flags;
+            const uint64_t tag = cqe->user_data;
+            m_ring.cqeSeen();
+            if (tag != kRecvTag)
+            {
+                // 従来方式のバッファ提供の完了通知
+                continue;
+            }
+            if (!(flags & IORING_CQE_F_MORE))
+            {
+                m_armed = false;
+            }
+            if (res < 0)
+            {
+                if (res != -ENOBUFS)
+                {
+                    // 取り出し済みのデータグラムを返し、末尾で再投入する
+                    error = res;
+                    break;
+                }
+                if (m_bufRing.get() != nullptr && !m_ringDelivered)
+                {
+                    // 全バッファを供給済みの状態で一度も受信できない場合、バッファリングは機能していない
+                    fallbackToLegacy();
+                }
+                // バッファが尽きた場合、データグラムはソケットの受信キューに残る
+                continue;
+            }
+            if (!(flags & IORING_CQE_F_BUFFER))
+            {
+                continue;
+            }
+            const uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+            m_inUse.push_back(bid);
+            m_ringDelivered = true;
+            char *buf = buffer(bid);
+            io_uring_recvmsg_out recvOut;
+            std::memcpy(&recvOut, buf, sizeof(recvOut));
+            Datagram datagram{};
+            datagram.header.msg_control = buf + sizeof(io_uring_recvmsg_out);
+            datagram.header.msg_controllen = recvOut.controllen;
+            datagram.header.msg_flags = static_cast<int>(recvOut.flags);
+            datagram.data = buf + sizeof(io_uring_recvmsg_out) + m_controlSize;
+            datagram.length = recvOut.payloadlen;
+            out.push_back(datagram);
+            count++;
+        }
+        if (!m_armed && m_inUse.empty())
+        {
+            arm();
+        }
+        return error;
+    }
+
+    /**
+     * @brief 完了通知を待機するためのファイル記述子を返します
+     *
+     * @return int
+     */
+    int fd() const { return m_ring.fd(); }
+
+private:
+    /**
+     * @brief バッファリングを登録し、全バッファを供給します
+     *
+     * @return true 登録成功
+     * @return false バッファリングに未対応
+     */
+    bool registerBufferRing()
+    {
+        if (!m_bufRing.map(m_bufferCount * sizeof(io_uring_buf)))
+        {
+            return false;
+        }
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(m_bufRing.get());
+        reg.ring_entries = static_cast<uint32_t>(m_bufferCount);
+        reg.bgid = kBufferGroup;
+        if (syscall(__NR_io_uring_register, m_ring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        {
+            m_bufRing.reset();
+            return false;
+        }
+        for (size_t bid = 0; bid < m_bufferCount; ++bid)
+        {
+            provideRing(static_cast<uint16_t>(bid), static_cast<uint16_t>(bid));
+        }
+        m_bufTail = static_cast<uint16_t>(m_bufferCount);
+        __atomic_store_n(&m_bufRing->tail, m_bufTail, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /**
+     * @brief バッファリングの登録を解除し、従来方式の提供バッファへ切り替えます
+     * @details アプリケーションが保持中のバッファは、recycle()で従来方式により返却する
+     */
+    void fallbackToLegacy()
+    {
+        io_uring_buf_reg reg{};
+        reg.bgid = kBufferGroup;
+        syscall(__NR_io_uring_register, m_ring.fd(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        m_bufRing.reset();
+        std::vector<bool> held(m_bufferCount, false);
+        for (auto bid : m_inUse)
+        {
+            held[bid] = true;
+        }
+        for (size_t bid = 0; bid < m_bufferCount; ++bid)
+        {
+            if (!held[bid])
+            {
+                provideLegacy(static_cast<uint16_t>(bid), 1, false);
+            }
+        }
+        m_ring.submit();
+    }
+
+    /**
+     * @brief 構成直後にマルチショットrecvmsgが受け付けられたかを確認します
+     * @details 非対応のカーネルでは投入直後にエラーの完了エントリが届く。ここで例外とすることで、
+     * 利用者がイベント待機用のハンドル(fd())を取得する前に通常のソケットAPIへ切り替えられる。
+     * 受信済みのデータグラムの完了エントリは取り出さずに残す
+     */
+    void checkArmed()
+    {
+        if (!m_armed)
+        {
+            throw std::system_error(EBUSY, std::generic_category(), "io_uring recvmsg submission");
+        }
+        for (io_uring_cqe *cqe = m_ring.peekCqe(); cqe != nullptr; cqe = m_ring.peekCqe())
+        {
+            if (cqe->user_data != kRecvTag)
+            {
+                m_ring.cqeSeen();
+                continue;
+            }
+            if (cqe->res < 0 && cqe->res != -ENOBUFS && !(cqe->flags & IORING_CQE_F_MORE))
+            {
+                throw std::system_error(-cqe->res, std::generic_category(), "io_uring recvmsg");
+            }
+            return;
+        }
+    }
+
+    /**
+     * @brief マルチショットrecvmsgを投入します
+     *
+     */
+    void arm()
+    {
+        io_uring_sqe *sqe = m_ring.getSqe();
+        if (sqe == nullptr)
+        {
+            return;
+        }
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = m_sock;
+        sqe->addr = reinterpret_cast<uint64_t>(&m_msgTemplate);
+        sqe->len = 1;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kBufferGroup;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->msg_flags = MSG_TRUNC;
+        sqe->user_data = kRecvTag;
+        if (m_ring.submit() >= 0)
+        {
+            m_armed = true;
+        }
+    }
+
+    /**
+     * @brief バッファをバッファリングの指定位置に登録します(tailの更新は呼び出し側で行う)
+     *
+     * @param index バッファリング上の位置
+     * @param bid バッファ番号
+     */
+    void provideRing(uint16_t index, uint16_t bid)
+    {
+        io_uring_buf &entry = m_bufRing->bufs[index & (m_bufferCount - 1)];
+        entry.addr = reinterpret_cast<uint64_t>(buffer(bid));
+        entry.len = static_cast<uint32_t>(m_bufferSize);
+        entry.bid = bid;
+    }
+
+    /**
+     * @brief 連続したバッファを従来方式(IORING_OP_PROVIDE_BUFFERS)で供給します
+     *
+     * @param bid 先頭のバッファ番号
+     * @param count バッファ数
+     * @param submitNow trueの場合は直ちに投入する(falseの場合は次の投入にまとめる)
+     */
+    void provideLegacy(uint16_t bid, size_t count, bool submitNow = true)
+    {
+        io_uring_sqe *sqe = m_ring.getSqe();
+        if (sqe == nullptr)
+        {
+            m_ring.submit();
+            sqe = m_ring.getSqe();
+        }
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = static_cast<int>(count);
+        sqe->addr = reinterpret_cast<uint64_t>(buffer(bid));
+        sqe->len = static_cast<uint32_t>(m_bufferSize);
+        sqe->off = bid;
+        sqe->buf_group = kBufferGroup;
+        sqe->user_data = kProvideTag;
+        if (submitNow)
+        {
+            m_ring.submit();
+        }
+    }
+
+    char *buffer(uint16_t bid) { return m_buffers.data() + bid * m_bufferSize; }
+
+private:
+    /**
+     * @brief バッファリング用にマップした領域を保持し、破棄時に解放するクラス
+     * @details 構成の途中で例外が送出されても領域を解放できるよう、メンバとして保持する
+     */
+    class BufferRingMapping
+    {
+    public:
+        BufferRingMapping() = default;
+        ~BufferRingMapping() { reset(); }
+
+        BufferRingMapping(const BufferRingMapping &) = delete;
+        BufferRingMapping &operator=(const BufferRingMapping &) = delete;
+
+        /**
+         * @brief 領域をマップします(マップ済みの領域は解放します)
+         *
+         * @param size マップするサイズ
+         * @return true マップ成功
+         * @return false マップ失敗
+         */
+        bool map(size_t size)
+        {
+            reset();
+            void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+            if (ptr == MAP_FAILED)
+            {
+                return false;
+            }
+            m_ring = static_cast<io_uring_buf_ring *>(ptr);
+            m_size = size;
+            return true;
+        }
+
+        /**
+         * @brief マップした領域を解放します
+         *
+         */
+        void reset()
+        {
+            if (m_ring != nullptr)
+            {
+                munmap(m_ring, m_size);
+                m_ring = nullptr;
+                m_size = 0;
+            }
+        }
+
+        io_uring_buf_ring *get() const { return m_ring; }
+        io_uring_buf_ring *operator->() const { return m_ring; }
+
+    private:
+        io_uring_buf_ring *m_ring{nullptr};
+        size_t m_size{0};
+    };
+
+    static constexpr uint16_t kBufferGroup = 0;  //! 提供バッファのグループ番号
+    static constexpr size_t kMaxBuffers = 32768; //! バッファリングの最大エントリ数
+    static constexpr uint64_t kRecvTag = 1;      //! マルチショットrecvmsgの識別子
+    static constexpr uint64_t kProvideTag = 2;   //! 従来方式のバッファ提供の識別子
+
+    IoUringRing m_ring;
+    int m_sock;
+    size_t m_controlSize;
+    size_t m_bufferCount{0};
+    size_t m_bufferSize{0};
+    std::vector<char> m_buffers;           //! 登録した受信バッファ
+    BufferRingMapping m_bufRing;           //! バッファリング(従来方式の場合はget()がnullptr)
+    uint16_t m_bufTail{0};         //! バッファリングの末尾
+    std::vector<uint16_t> m_inUse; //! アプリケーションが保持中のバッファ番号
+    msghdr m_msgTemplate{};        //! マルチショットrecvmsgの受信形式
+    bool m_armed{false};           //! マルチショットrecvmsgが有効か
+    bool m_ringDelivered{false};   //! 提供バッファからの受信実績があるか
+};
+
+/**
+ * @brief sendmsgを投入キューにまとめて投入する送信処理
+ *
+ */
+class IoUringSender
+{
+public:
+    /**
+     * @brief 新しい送信処理を構成します
+     *
+     * @param sock 送信ソケット
+     * @param entries 投入キューのエントリ数
+     */
+    IoUringSender(int sock, unsigned entries)
+        : m_ring(entries), m_sock(sock)
+    {
+    }
+
+    /**
+     * @brief 複数のメッセージを送信し、すべての完了を待ちます
+     * @details 投入キューに収まる件数ごとに1回のシステムコールで投入と完了待ちを行う
+     * @param msgs 送信するメッセージ(msg_lenに送信バイト数を格納する)
+     * @param count メッセージ数
+     * @param errors 各メッセージのエラーコードの格納先(成功時は0)
+     */
+    void send(mmsghdr *msgs, size_t count, int *errors)
+    {
+        size_t offset = 0;
+        while (offset < count)
+        {
+            unsigned queued = 0;
+            io_uring_sqe *sqe;
+            while (offset + queued < count && (sqe = m_ring.getSqe()) != nullptr)
+            {
+                sqe->opcode = IORING_OP_SENDMSG;
+                sqe->fd = m_sock;
+                sqe->addr = reinterpret_cast<uint64_t>(&msgs[offset + queued].msg_hdr);
+                sqe->len = 1;
+                sqe->user_data = offset + queued;
+                queued++;
+            }
+            int ret = m_ring.submit(queued);
+            if (ret < 0)
+            {
+                for (unsigned i = 0; i < queued; ++i)
+                {
+                    errors[offset + i] = -ret;
+                }
+                offset += queued;
+                continue;
+            }
+            unsigned completed = 0;
+            while (completed < queued)
+            {
+                io_uring_cqe *cqe = m_ring.peekCqe();
+                if (cqe == nullptr)
+                {
+                    m_ring.submit(queued - completed);
+                    continue;
+                }
+                const size_t index = static_cast<size_t>(cqe->user_data);
+                if (cqe->res < 0)
+                {
+                    errors[index] = -cqe->res;
+                    msgs[index].msg_len = 0;
+                }
+                else
+                {
+                    errors[index] = 0;
+                    msgs[index].msg_len = static_cast<unsigned int>(cqe->res);
+                }
+                m_ring.cqeSeen();
+                completed++;
+            }
+            offset += queued;
+        }
+    }
+
+private:
+    IoUringRing m_ring;
+    int m_sock;
+};
+
+#endif // UDP_HANDLER_HAS_IO_URING
+#endif // IO_URING_HPP_
@@ -0,0 +1,189 @@
+/**
+ * @file LatencyHistogram.hpp
+ * @brief 遅延時間の分布を集計するヒストグラムの定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef LATENCY_HISTOGRAM_HPP_
+#define LATENCY_HISTOGRAM_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+/**
+ * @brief 遅延時間[nsec]の分布を固定サイズのバケットで集計するクラス
+ * @details 2のべき乗ごとの区間を8分割した対数バケットを使用するため、記録時にメモリ確保は発生せず、
+ * 百分位数の誤差は最大でも約12.5%に収まる。スレッドセーフではない
+ */
+class LatencyHistogram
+{
+public:
+    /**
+     * @brief 遅延時間を記録します
+     *
+     * @param nanoseconds 遅延時間[nsec](負の値は時刻のずれとみなし0として記録する)
+     */
+    void record(int64_t nanoseconds)
+    {
+        const uint64_t value = nanoseconds < 0 ? 0 : static_cast<uint64_t>(nanoseconds);
+        m_buckets[bucketIndex(value)]++;
+        m_count++;
+        m_sum += value;
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+    }
+
+    /**
+     * @brief 別のヒストグラムの集計結果を加算します
+     *
+     * @param other 加算するヒストグラム
+     */
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t i = 0; i < kBucketCount; ++i)
+        {
+            m_buckets[i] += other.m_buckets[i];
+        }
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    /**
+     * @brief 集計結果を初期化します
+     *
+     */
+    void reset() { *this = LatencyHistogram(); }
+
+    /**
+     * @brief 記録数を返します
+     *
+     * @return uint64_t
+     */
+    uint64_t count() const { return m_count; }
+
+    /**
+     * @brief 最小値[nsec]を返します
+     *
+     * @return uint64_t 記録が無い場合は0
+     */
+    uint64_t min() const { return m_count == 0 ? 0 : m_min; }
+
+    /**
+     * @brief 最大値[nsec]を返します
+     *
+     * @return uint64_t
+     */
+    uint64_t max() const { return m_max; }
+
+    /**
+     * @brief 平均値[nsec]を返します
+     *
+     * @return double 記録が無い場合は0
+     */
+    double mean() const { return m_count == 0 ? 0.0 : static_cast<double>(m_sum) / static_cast<double>(m_count); }
+
+    /**
+     * @brief 百分位数[nsec]を返します
+     * @details 該当するバケットの上限値を返す(最大値を超えない)
+     * @param percent 百分率(0～100)
+     * @return uint64_t 記録が無い場合は0
+     */
+    uint64_t percentile(double percent) const
+    {
+        if (m_count == 0)
+        {
+            return 0;
+        }
+        const double clamped = std::min(100.0, std::max(0.0, percent));
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(m_count) + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i)
+        {
+            seen += m_buckets[i];
+            if (seen >= rank)
+            {
+                return std::min(std::max(bucketUpperBound(i), min()), m_max);
+            }
+        }
+        return m_max;
+    }
+
+    /**
+     * @brief ログ出力用の要約文字列を返します
+     * @details 単位はマイクロ秒
+     * @return std::string
+     */
+    std::string summary() const
+    {
+        auto us = [](double ns)
+        { return std::to_string(ns / 1000.0); };
+        return "count=" + std::to_string(m_count) +
+               " min=" + us(static_cast<double>(min())) +
+               "us p50=" + us(static_cast<double>(percentile(50))) +
+               "us p99=" + us(static_cast<double>(percentile(99))) +
+               "us p99.9=" + us(static_cast<double>(percentile(99.9))) +
+               "us max=" + us(static_cast<double>(m_max)) + "us";
+    }
+
+private:
+    static constexpr unsigned kSubBits = 3;                            //! 2のべき乗区間の分割数(2^kSubBits)
+    static constexpr uint64_t kLinearLimit = 1u << (kSubBits + 1);     //! 値をそのままバケット番号とする上限
+    static constexpr size_t kBucketCount = kLinearLimit + (64 - kSubBits - 1) * (1u << kSubBits); //! バケット数
+
+    /**
+     * @brief 値に対応するバケット番号を返します
+     *
+     * @param value 値
+     * @return size_t
+     */
+    static size_t bucketIndex(uint64_t value)
+    {
+        if (value < kLinearLimit)
+        {
+            return static_cast<size_t>(value);
+        }
+        unsigned exponent = 63;
+        while ((value >> exponent) == 0)
+        {
+            exponent--;
+        }
+        const uint64_t sub = (value >> (exponent - kSubBits)) & ((1u << kSubBits) - 1);
+        return static_cast<size_t>(kLinearLimit + (exponent - kSubBits - 1) * (1u << kSubBits) + sub);
+    }
+
+    /**
+     * @brief バケットに含まれる最大値を返します
+     *
+     * @param index バケット番号
+     * @return uint64_t
+     */
+    static uint64_t bucketUpperBound(size_t index)
+    {
+        if (index < kLinearLimit)
+        {
+            return index;
+        }
+        const size_t offset = index - kLinearLimit;
+        const unsigned exponent = static_cast<unsigned>(offset >> kSubBits) + kSubBits + 1;
+        const uint64_t sub = offset & ((1u << kSubBits) - 1);
+        const uint64_t lower = (uint64_t{1} << exponent) + (sub << (exponent - kSubBits));
+        return lower + (uint64_t{1} << (exponent - kSubBits)) - 1;
+    }
+
+    std::array<uint64_t, kBucketCount> m_buckets{};             //! バケットごとの記録数
+    uint64_t m_count{0};                                         //! 記録数
+    uint64_t m_sum{0};                                           //! 記録値の合計
+    uint64_t m_min{std::numeric_limits<uint64_t>::max()};       //! 最小値
+    uint64_t m_max{0};                                           //! 最大値
+};
+
+#endif // LATENCY_HISTOGRAM_HPP_
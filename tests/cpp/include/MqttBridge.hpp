@@ -1,23 +1,134 @@
 #ifndef MQTT_HANDLER_HPP_
 #define MQTT_HANDLER_HPP_
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include "spdlog/spdlog.h"
 #include "UdpHandler.hpp"
+#include "UnixDatagramHandler.hpp"
+#include "SendQueue.hpp"
+#include "ShmRing.hpp"
+#include "SequenceTracker.hpp"
+#include "FrameReassembler.hpp"
+#include "TopicRouter.hpp"
+#include "Envelope.hpp"
+#include "Conflator.hpp"
+#include "TopicRegistry.hpp"
 #include "PlotPoints.hpp"
 
-class MqttBridge : public UdpHandler
+/**
+ * @brief トピックとメッセージ本体の組(受信バッファを参照するビュー)
+ */
+using TopicMessageView = std::pair<std::string_view, std::string_view>;
+
+/**
+ * @brief 登録したトピックごとの送受信数
+ */
+struct TopicCounters
+{
+    uint64_t published{0}; //! publish()で発行したメッセージ数(間引かれたものを含む)
+    uint64_t received{0};  //! dispatch()で振り分けたメッセージ数
+};
+
+/**
+ * @brief データグラムをトピックとメッセージ本体に分割します
+ * @details 区切り文字が無い場合は、全体をトピックとしメッセージ本体を空とする
+ * @param s データグラム
+ * @param delim 区切り文字
+ * @return TopicMessageView
+ */
+inline TopicMessageView splitTopicMessage(std::string_view s, char delim = '\n')
+{
+    auto pos = s.find(delim);
+    if (pos == std::string_view::npos)
+    {
+        // 改行なし
+        return {s, std::string_view{}};
+    }
+    return {s.substr(0, pos), s.substr(pos + 1)};
+}
+
+#ifdef UDP_HANDLER_HAS_COROUTINE
+class AsyncSubscribe;
+#endif
+
+/**
+ * @brief "トピック\nメッセージ本体"形式のメッセージを送受信するMQTT中継
+ * @details 送受信はTransport(DatagramTransportの実装)が行う。
+ * UDPではMqttBridge、同一ホスト内のAF_UNIXソケットではUnixMqttBridgeを使用する
+ * @tparam Transport 使用するトランスポート(UdpHandlerまたはUnixDatagramHandler)
+ */
+template <class Transport>
+class BasicMqttBridge : public Transport
 {
 public:
-    MqttBridge(const std::string &recvIp, uint16_t recvPort,
-               const std::string &sendIp, uint16_t sendPort)
-        : UdpHandler(recvIp, recvPort, sendIp, sendPort)
+    static constexpr size_t kDefaultTopicLimit = 4096; //! publish()が自動で登録するトピック数の既定の上限
+
+    /**
+     * @brief 新しいMQTT中継を構成します
+     * @details 引数はそのままTransportのコンストラクタに渡す
+     * @param args Transportのコンストラクタ引数
+     */
+    template <class... Args>
+    explicit BasicMqttBridge(Args &&...args)
+        : Transport(std::forward<Args>(args)...)
     {
     }
+    /**
+     * @brief MQTT中継を破棄します
+     * @details 間引きの枠やエンベロープに送信待ちのメッセージが残っている場合は送信する
+     */
+    ~BasicMqttBridge()
+    {
+        flushConflated();
+        if (m_envelope && m_envelope->records() > 0)
+        {
+            sendEnvelope();
+        }
+    }
     std::optional<std::pair<std::string, std::string>> subscribe(int timeoutMs = 100)
     {
-        auto rep = this->receive(timeoutMs);
+        auto msg = subscribeView(timeoutMs);
+        if (msg)
+        {
+            return std::make_pair(std::string(msg->first), std::string(msg->second));
+        }
+        return std::nullopt;
+    }
+    /**
+     * @brief メッセージを購読します(コピーなし)
+     * @details 受信バッファを参照するビューとしてトピックとメッセージ本体を返すため、メモリ確保は発生しない。
+     * 戻り値は次の受信処理を呼び出すまで有効。エンベロープを受信した場合は、含まれるメッセージを1件ずつ返す
+     * (残りがある間は受信せずに返す)
+     * @param timeoutMs タイムアウト時間[msec]
+     * @return std::optional<TopicMessageView> 受信したメッセージ(未受信またはメッセージ本体が空の場合はstd::nullopt)
+     */
+    std::optional<TopicMessageView> subscribeView(int timeoutMs = 100)
+    {
+        std::optional<TopicId> id;
+        if (m_envelopeIndex < m_envelopeRecords.size())
+        {
+            return nextEnvelopeRecord(id);
+        }
+        releaseFrames();
+        auto rep = this->receiveView(timeoutMs);
         if (rep)
         {
-            auto msg = split(rep.value());
+            if (isEnvelope(rep.value()))
+            {
+                unpackEnvelope(rep.value());
+                return nextEnvelopeRecord(id);
+            }
+            auto msg = unwrap(rep.value(), id);
             if (msg.second.length() == 0)
             {
                 return std::nullopt;
@@ -26,27 +137,695 @@ public:
         }
         return std::nullopt;
     }
-    void publish(const std::string &topic, const std::string &payload)
+    /**
+     * @brief 受信キューに溜まっているメッセージをまとめて購読します
+     * @details receiveBatch()で取り出したデータグラムをトピックとメッセージ本体に分割する。
+     * エンベロープは含まれるメッセージに展開する。メッセージ本体が空のデータグラムは除外する。
+     * 戻り値は次の受信処理を呼び出すまで有効。subscribeView()が返していないエンベロープの残りがある場合は、それのみを返す
+     * @param maxCount 1回で取り出す最大データグラム数
+     * @param timeoutMs タイムアウト時間[msec]
+     * @return const std::vector<TopicMessageView>& 受信したメッセージ群(未受信の場合は空)
+     */
+    const std::vector<TopicMessageView> &subscribeBatch(size_t maxCount = 16, int timeoutMs = 100)
+    {
+        m_topicBatch.clear();
+        m_topicBatchIds.clear();
+        std::optional<TopicId> id;
+        if (m_envelopeIndex < m_envelopeRecords.size())
+        {
+            while (auto msg = nextEnvelopeRecord(id))
+            {
+                m_topicBatch.push_back(*msg);
+                m_topicBatchIds.push_back(std::exchange(id, std::nullopt));
+            }
+            return m_topicBatch;
+        }
+        releaseFrames();
+        for (const auto &datagram : this->receiveBatch(maxCount, timeoutMs))
+        {
+            if (isEnvelope(datagram))
+            {
+                unpackEnvelope(datagram);
+                while (auto msg = nextEnvelopeRecord(id))
+                {
+                    m_topicBatch.push_back(*msg);
+                    m_topicBatchIds.push_back(std::exchange(id, std::nullopt));
+                }
+                continue;
+            }
+            auto msg = unwrap(datagram, id);
+            if (!msg.second.empty())
+            {
+                m_topicBatch.push_back(msg);
+                m_topicBatchIds.push_back(id);
+            }
+            id.reset();
+        }
+        return m_topicBatch;
+    }
+    /**
+     * @brief トピックフィルタにハンドラを登録します
+     * @details フィルタにはMQTTのワイルドカード('+'は任意の1階層、'#'は残りの全階層)を使用できる。
+     * 登録したハンドラはdispatch()で受信したメッセージのトピックに一致した場合に呼び出される
+     * @param filter トピックフィルタ
+     * @param handler ハンドラ
+     * @return TopicRouter::HandlerId 解除に使う識別番号
+     */
+    TopicRouter::HandlerId addHandler(std::string_view filter, TopicRouter::Handler handler)
+    {
+        return m_router.add(filter, std::move(handler));
+    }
+    /**
+     * @brief 登録したハンドラを解除します
+     *
+     * @param id addHandler()が返した識別番号
+     * @return true 解除した
+     * @return false 登録されていない
+     */
+    bool removeHandler(TopicRouter::HandlerId id) { return m_router.remove(id); }
+    /**
+     * @brief 受信キューに溜まっているメッセージをまとめて購読し、トピックに一致するハンドラを呼び出します
+     * @details subscribeBatch()で受信したメッセージを1件ずつ振り分ける。一致するハンドラが無いメッセージは破棄し、
+     * router().stats().unmatchedに数える。internTopic()で登録済みのトピックは、IDごとに一致したハンドラを記憶して
+     * 2回目以降はトピックの木をたどらずに呼び出し、topicCounters()の受信数に数える
+     * @param maxCount 1回で取り出す最大データグラム数
+     * @param timeoutMs タイムアウト時間[msec]
+     * @return size_t 受信したメッセージ数
+     */
+    size_t dispatch(size_t maxCount = 16, int timeoutMs = 100)
+    {
+        return dispatchBatch(maxCount, timeoutMs, [](std::string_view, std::string_view) {});
+    }
+    /**
+     * @brief トピックを登録し、IDを返します
+     * @details 登録済みの場合は既存のIDを返す。起動時に使用するトピックを登録しておき、
+     * 以降はIDで発行することで、発行・振り分け・統計でトピック文字列の検索や比較を行わない
+     * @param topic トピック
+     * @return TopicId
+     */
+    TopicId internTopic(std::string_view topic)
+    {
+        const TopicId id = m_topics.intern(topic);
+        if (id >= m_topicCounters.size())
+        {
+            m_topicCounters.resize(id + 1);
+            m_sendSequences.resize(id + 1, 0);
+        }
+        return id;
+    }
+    /**
+     * @brief 登録済みのトピックの一覧を返します
+     *
+     * @return const TopicRegistry&
+     */
+    const TopicRegistry &topics() const { return m_topics; }
+    /**
+     * @brief publish(std::string_view, std::string_view)が自動で登録するトピック数の上限を設定します
+     * @details 任意のトピック名で発行されても、登録表、送受信数、通し番号の状態が際限なく増えないようにする。
+     * internTopic()による明示的な登録は上限を受けないが、登録数には含まれる
+     * @param limit 登録数の上限(既定:kDefaultTopicLimit)
+     */
+    void setTopicLimit(size_t limit) { m_topicLimit = limit; }
+    /**
+     * @brief 登録数の上限に達したため、登録せずに発行したメッセージ数を返します
+     *
+     * @return uint64_t
+     */
+    uint64_t unregisteredPublished() const { return m_unregisteredPublished; }
+    /**
+     * @brief 登録したトピックの送受信数を返します
+     *
+     * @param id トピックのID
+     * @return const TopicCounters&
+     */
+    const TopicCounters &topicCounters(TopicId id) const { return m_topicCounters.at(id); }
+    /**
+     * @brief ハンドラの振り分け表を返します
+     *
+     * @return const TopicRouter&
+     */
+    const TopicRouter &router() const { return m_router; }
+#ifdef UDP_HANDLER_HAS_COROUTINE
+    /**
+     * @brief 指定したトピックの次のメッセージを非同期に購読します(co_await用)
+     * @details 定義はAsyncLoop.hppにある。メッセージが届くまでコルーチンを中断し、スレッドを占有しない。
+     * 同じトピックを待機している全てのコルーチンが同じメッセージを受け取る。一度も購読していないトピックのメッセージは破棄する。
+     * 購読したことのあるトピックで待機中のコルーチンが無い間に届いたメッセージは保留し、次の購読で1件ずつ渡す
+     * (上限を超えた分はAsyncLoop::subscribeDropped()に数える)。購読待ちがある間は受信をイベントループがdispatch()と同じ処理で行うため、
+     * エンベロープの展開、断片の再構成、通し番号の追跡、登録したハンドラの呼び出しと統計も同様に行われる。
+     * subscribe系の関数と併用しないこと
+     * @param loop コルーチンを駆動するイベントループ
+     * @param topic 購読するトピック
+     * @param timeoutMs タイムアウト時間[msec](負の場合は無期限)
+     * @return AsyncSubscribe co_awaitの結果はstd::optional<std::string>(メッセージ本体。タイムアウト時はstd::nullopt)
+     */
+    AsyncSubscribe async_subscribe(AsyncLoop &loop, std::string topic, int timeoutMs = -1);
+#endif
+    /**
+     * @brief メッセージを発行します
+     * @details トピック、区切り文字、メッセージ本体を個別のI/Oベクタとして送信するため、
+     * メッセージ本体(シリアライズ結果など)はユーザ空間でコピーされない。
+     * enableSendQueue()で送信キューを有効にした場合は、キューに追加して直ちに戻る。
+     * enableSharedMemoryRing()で共有メモリリングを有効にした場合は、同じフレームを通し番号ヘッダを除いてリングにも書き込む(分割はしない)。
+     * enableFragmentation()で分割を有効にした場合は、maxDatagramSizeを超えるフレームを断片に分けて送信する。
+     * enableCoalescing()でまとめて送信する場合は、エンベロープにコピーして直ちに戻る。
+     * enableConflation()で間引きを有効にした場合は、トピックの送信待ちの枠にコピーして直ちに戻り、flushConflated()で送信する。
+     * 未登録のトピックは登録数がsetTopicLimit()の上限未満であればinternTopic()で登録する(メモリ確保は初回のみ)。
+     * 上限に達した後の未登録のトピックは登録せずに送信し、送受信数、間引き、通し番号は適用しない(unregisteredPublished()に数える)
+     * @param topic トピック
+     * @param payload メッセージ本体
+     */
+    void publish(std::string_view topic, std::string_view payload)
+    {
+        TopicId id = m_topics.find(topic);
+        if (id == kInvalidTopicId)
+        {
+            if (m_topics.size() >= m_topicLimit)
+            {
+                m_unregisteredPublished++;
+                publishFrame(topic, std::string_view{}, payload);
+                return;
+            }
+            id = internTopic(topic);
+        }
+        publish(id, payload);
+    }
+    /**
+     * @brief 登録したトピックのIDを指定してメッセージを発行します
+     * @details トピック文字列の検索を行わない以外はpublish(std::string_view, std::string_view)と同じ
+     * @param topic internTopic()が返したトピックのID
+     * @param payload メッセージ本体
+     */
+    void publish(TopicId topic, std::string_view payload)
+    {
+        m_topicCounters.at(topic).published++;
+        if (m_conflator)
+        {
+            m_conflator->update(topic, payload);
+            return;
+        }
+        publishNow(topic, payload);
+    }
+    /**
+     * @brief 発行するメッセージをトピックごとに間引くようにします
+     * @details publish()はトピックごとの送信待ちの枠に最新のメッセージのみを保持し、flushConflated()で送信する。
+     * 周期処理の終わりなどでflushConflated()を呼び出すこと。送信量は更新数ではなくトピック数で抑えられる。
+     * 通し番号、共有メモリリング、エンベロープ、分割、送信キューは送信時に適用するため、間引かれたメッセージは欠落として数えない
+     */
+    void enableConflation()
+    {
+        if (!m_conflator)
+        {
+            m_conflator = std::make_unique<Conflator>();
+        }
+    }
+    /**
+     * @brief 送信待ちの全トピックの最新のメッセージを送信します
+     *
+     * @return size_t 送信したメッセージ数
+     */
+    size_t flushConflated()
+    {
+        if (!m_conflator)
+        {
+            return 0;
+        }
+        return m_conflator->flush([this](TopicId topic, std::string_view payload)
+                                  { publishNow(topic, payload); });
+    }
+    /**
+     * @brief 間引き処理の統計値を返します
+     *
+     * @return ConflationStats 間引きが無効の場合は全て0
+     */
+    ConflationStats conflationStats() const
+    {
+        return m_conflator ? m_conflator->stats() : ConflationStats{};
+    }
+    /**
+     * @brief メッセージを発行します(複数スレッドから同時に呼び出し可能)
+     * @details 呼び出し元スレッドごとの送信ソケット(sendConcurrent())から送信するため、発行するスレッド間でロックを取らない。
+     * 通し番号、分割、共有メモリリング、送信キューはスレッド間で共有する状態を持つため適用せず、
+     * 「トピック\nメッセージ本体」の形式でそのまま送信する
+     * @param topic トピック
+     * @param payload メッセージ本体
+     * @return true 送信成功
+     * @return false 送信失敗
+     */
+    bool publishConcurrent(std::string_view topic, std::string_view payload)
+    {
+        const std::string_view parts[] = {topic, kSeparator, payload};
+        return this->sendConcurrent(parts, std::size(parts));
+    }
+    /**
+     * @brief 小さなメッセージを1つのデータグラム(エンベロープ)にまとめて送信するようにします
+     * @details publish()はメッセージを長さ付きのレコードとしてエンベロープに追加し、次のメッセージが
+     * maxDatagramSizeに収まらない場合、または最初のメッセージからmaxDelayを過ぎた後のpublish()で送信する。
+     * 発行が途絶えた場合にmaxDelayを超えて滞留しないよう、周期処理からflushDueEnvelope()を呼び出すこと。
+     * エンベロープの受信側での展開はsubscribe系の関数が常に行う。送信時に1件しか無い場合は通常の形式で送信する
+     * @param options 構成オプション
+     */
+    void enableCoalescing(const CoalesceOptions &options = CoalesceOptions{})
+    {
+        if (m_envelope && m_envelope->records() > 0)
+        {
+            sendEnvelope();
+        }
+        m_envelope = std::make_unique<EnvelopeBuilder>(options);
+    }
+    /**
+     * @brief エンベロープに溜まっているメッセージを直ちに送信します
+     *
+     */
+    void flushEnvelope()
+    {
+        if (m_envelope && m_envelope->records() > 0)
+        {
+            sendEnvelope();
+            m_coalesceStats.flushedExplicitly++;
+        }
+    }
+    /**
+     * @brief 送信期限(maxDelay)を過ぎたエンベロープを送信します
+     * @details EventReactorの周期処理など、maxDelay以下の間隔で呼び出して追加の遅延を抑える
+     * @param now 現在時刻
+     * @return true 送信した
+     * @return false 送信期限前、またはエンベロープが空
+     */
+    bool flushDueEnvelope(EnvelopeBuilder::Clock::time_point now = EnvelopeBuilder::Clock::now())
+    {
+        if (!m_envelope || m_envelope->records() == 0 || now < m_envelope->deadline())
+        {
+            return false;
+        }
+        sendEnvelope();
+        m_coalesceStats.flushedExplicitly++;
+        return true;
+    }
+    /**
+     * @brief メッセージをまとめて送受信した統計値を返します
+     *
+     * @return const CoalesceStats&
+     */
+    const CoalesceStats &coalesceStats() const { return m_coalesceStats; }
+    /**
+     * @brief データグラムに収まらないフレームの分割と再構成を有効にします
+     * @details publish()はmaxDatagramSizeを超えるフレームを断片(トピック、区切り文字、分割ヘッダ、フレームの一部)に分けて送信し、
+     * subscribe系の関数は断片を再構成して1つのメッセージとして返す。reassemblyTimeout以内に揃わなかったフレームは破棄して数える。
+     * 相手側も分割ヘッダを解釈できる場合のみ有効にすること
+     * @param options 構成オプション
+     */
+    void enableFragmentation(const FragmentOptions &options = FragmentOptions{})
+    {
+        m_fragmentOptions = options;
+        m_reassembler = std::make_unique<FrameReassembler>(m_fragmentOptions, m_fragmentStats);
+        // 再起動後にフレーム番号が0から振り直されても、受信側で以前の断片と混ざらないようにする
+        m_fragmentSenderId = std::random_device{}();
+    }
+    /**
+     * @brief フレーム分割・再構成の統計値を返します
+     *
+     * @return const FragmentStats&
+     */
+    const FragmentStats &fragmentStats() const { return m_fragmentStats; }
+    /**
+     * @brief 通し番号ヘッダによる欠落・重複・順序入れ替わりの検出を有効にします
+     * @details publish()はメッセージ本体の先頭にトピックごとの通し番号と送信時刻(kSequenceHeaderSizeバイト)を付加し、
+     * subscribe系の関数は受信したヘッダを取り除いて通し番号を追跡する。ヘッダの無いメッセージはそのまま受け取る。
+     * 相手側もヘッダを解釈できる場合のみ有効にすること(既定の"トピック\nメッセージ本体"形式とは互換性が無い)
+     */
+    void enableSequencing() { m_isSequencing = true; }
+    /**
+     * @brief 受信したメッセージの通し番号の追跡結果を返します
+     *
+     * @return const SequenceTracker&
+     */
+    const SequenceTracker &sequenceTracker() const { return m_sequenceTracker; }
+    /**
+     * @brief publish()を非同期の送信キュー経由に切り替えます
+     * @details 送信バッファの満杯や送信経路の遅延でpublish()の呼び出し元が停止しなくなる。
+     * 有効化した後は、送信処理(send系の関数)を直接呼び出さないこと
+     * @param options 送信キューの構成オプション
+     */
+    void enableSendQueue(const SendQueueOptions &options = SendQueueOptions{})
+    {
+        m_sendQueue = std::make_unique<SendQueue>(*this, options);
+    }
+    /**
+     * @brief 送信キューを返します
+     * @details 深さや破棄数の参照、drainThreadを無効にした場合のdrain()の呼び出しに使用する
+     * @return SendQueue* 送信キュー(無効の場合はnullptr)
+     */
+    SendQueue *sendQueue() { return m_sendQueue.get(); }
+#ifndef _WIN32
+    /**
+     * @brief publish()したフレームを共有メモリリングにも書き込むようにします
+     * @details 同一ホストのプロセスはShmRingReaderでシステムコールなしにフレームを読み出せる。
+     * フレームの形式は"トピック\nメッセージ本体"のため、splitTopicMessage()で分割できる
+     * (enableSequencing()を有効にしても通し番号ヘッダは書き込まない)。
+     * publish()は1つのスレッドから呼び出すこと
+     * @param path リングのファイルパス(/dev/shm配下を推奨)
+     * @param options リングの構成オプション
+     */
+    void enableSharedMemoryRing(const std::string &path, const ShmRingOptions &options = ShmRingOptions{})
     {
-        std::string msg = topic + "\n" + payload;
-        this->send(msg);
+        m_ring = std::make_unique<ShmRingWriter>(path, options);
     }
+    /**
+     * @brief 共有メモリリングを返します
+     *
+     * @return ShmRingWriter* 共有メモリリング(無効の場合はnullptr)
+     */
+    ShmRingWriter *sharedMemoryRing() { return m_ring.get(); }
+#endif
 
 private:
-    std::pair<std::string, std::string> split(const std::string &s, char delim = '\n')
+    /**
+     * @brief 受信キューに溜まっているメッセージをまとめて購読し、ハンドラを呼び出した後に各メッセージを渡します
+     * @details dispatch()とasync_subscribe()のイベントループが共通で使う受信処理。
+     * 受信したデータグラムの解釈(エンベロープ、断片、通し番号)はsubscribeBatch()が行う
+     * @param maxCount 1回で取り出す最大データグラム数
+     * @param timeoutMs タイムアウト時間[msec]
+     * @param observer 各メッセージ(トピック、メッセージ本体)を受け取る関数(呼び出し中のみ有効)
+     * @return size_t 受信したメッセージ数
+     */
+    template <class Observer>
+    size_t dispatchBatch(size_t maxCount, int timeoutMs, Observer &&observer)
     {
-        auto pos = s.find(delim);
-        if (pos == std::string::npos)
+        const auto &batch = subscribeBatch(maxCount, timeoutMs);
+        for (size_t i = 0; i < batch.size(); ++i)
         {
-            // 改行なし
-            return {s, std::string{}};
+            const auto &[topic, message] = batch[i];
+            // 通し番号の追跡で検索済みの場合は、そのIDを使う
+            const TopicId id = m_topicBatchIds[i] ? *m_topicBatchIds[i] : m_topics.find(topic);
+            if (id != kInvalidTopicId)
+            {
+                m_topicCounters[id].received++;
+            }
+            m_router.dispatch(id, topic, message);
+            observer(topic, message);
+        }
+        return batch.size();
+    }
+
+    /**
+     * @brief 間引きを経由せずにメッセージを発行します
+     *
+     * @param id トピックのID
+     * @param payload メッセージ本体
+     */
+    void publishNow(TopicId id, std::string_view payload)
+    {
+        char headerBuffer[kSequenceHeaderSize];
+        const std::string_view header = m_isSequencing ? nextSequenceHeader(id, headerBuffer) : std::string_view{};
+        publishFrame(m_topics.name(id), header, payload);
+    }
+
+    /**
+     * @brief フレームを共有メモリリング、エンベロープ、分割、送信キューを経由して発行します
+     *
+     * @param topic トピック
+     * @param header 通し番号ヘッダ(無効の場合は空)
+     * @param payload メッセージ本体
+     */
+    void publishFrame(std::string_view topic, std::string_view header, std::string_view payload)
+    {
+        const std::string_view parts[] = {topic, kSeparator, header, payload};
+#ifndef _WIN32
+        if (m_ring)
+        {
+            // リングの読み出し側は通し番号ヘッダを解釈しないため、ヘッダを除いて書き込む
+            const std::string_view ringParts[] = {topic, kSeparator, payload};
+            m_ring->writeGather(ringParts, std::size(ringParts));
+        }
+#endif
+        if (m_envelope)
+        {
+            const std::string_view body[] = {header, payload};
+            const size_t bodySize = header.size() + payload.size();
+            if (m_envelope->fitsAlone(topic.size(), bodySize))
+            {
+                if (!m_envelope->fits(topic.size(), bodySize))
+                {
+                    sendEnvelope();
+                    m_coalesceStats.flushedBySize++;
+                }
+                const auto now = EnvelopeBuilder::Clock::now();
+                m_envelope->append(topic, body, std::size(body), now);
+                m_coalesceStats.recordsCoalesced++;
+                if (now >= m_envelope->deadline())
+                {
+                    sendEnvelope();
+                    m_coalesceStats.flushedByDelay++;
+                }
+                return;
+            }
+            // エンベロープに収まらないメッセージは、順序を保つためまとめた分を先に送信してから送信する
+            if (m_envelope->records() > 0)
+            {
+                sendEnvelope();
+                m_coalesceStats.flushedBySize++;
+            }
+        }
+        if (m_reassembler &&
+            topic.size() + kSeparator.size() + header.size() + payload.size() > m_fragmentOptions.maxDatagramSize)
+        {
+            publishFragments(topic, header, payload);
+            return;
+        }
+        emit(parts, std::size(parts));
+    }
+
+    /**
+     * @brief 1つのデータグラムを送信します(送信キューが有効な場合はキューに追加します)
+     *
+     * @param parts 連結して送信する領域の配列
+     * @param count 領域の数
+     */
+    void emit(const std::string_view *parts, size_t count)
+    {
+        if (m_sendQueue)
+        {
+            m_sendQueue->push(parts, count);
+            return;
+        }
+        this->sendGather(parts, count);
+    }
+
+    /**
+     * @brief エンベロープを送信して空にします
+     * @details メッセージが1件のみの場合は、エンベロープを解釈しない受信側でも受け取れるよう通常の形式で送信する
+     */
+    void sendEnvelope()
+    {
+        if (m_envelope->records() == 1)
+        {
+            const std::string_view parts[] = {m_envelope->firstTopic(), kSeparator, m_envelope->firstPayload()};
+            emit(parts, std::size(parts));
+            m_coalesceStats.singlesSent++;
+        }
+        else
+        {
+            const std::string_view parts[] = {m_envelope->data()};
+            emit(parts, std::size(parts));
+            m_coalesceStats.envelopesSent++;
+        }
+        m_envelope->clear();
+    }
+
+    /**
+     * @brief 受信したエンベロープを展開し、含まれるメッセージをsubscribe系の関数が返す待ち行列に入れます
+     *
+     * @param datagram 受信したエンベロープ
+     */
+    void unpackEnvelope(std::string_view datagram)
+    {
+        m_envelopeRecords.clear();
+        m_envelopeIndex = 0;
+        const size_t count = decodeEnvelope(datagram, [this](std::string_view topic, std::string_view payload)
+                                            { m_envelopeRecords.emplace_back(topic, payload); });
+        if (count == 0)
+        {
+            m_coalesceStats.malformedEnvelopes++;
+            return;
+        }
+        m_coalesceStats.envelopesReceived++;
+        m_coalesceStats.recordsReceived += count;
+    }
+
+    /**
+     * @brief 展開済みのエンベロープから、メッセージ本体が空でない次のメッセージを取り出します
+     *
+     * @param id 取り出したメッセージのトピックを検索した場合はそのID(検索しなかった場合は変更しない)
+     * @return std::optional<TopicMessageView> 取り出したメッセージ(残りが無い場合はstd::nullopt)
+     */
+    std::optional<TopicMessageView> nextEnvelopeRecord(std::optional<TopicId> &id)
+    {
+        while (m_envelopeIndex < m_envelopeRecords.size())
+        {
+            id.reset();
+            auto msg = unwrapMessage(m_envelopeRecords[m_envelopeIndex++], id);
+            if (!msg.second.empty())
+            {
+                return msg;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief フレームを断片に分けて送信します
+     * @details フレーム(通し番号ヘッダとメッセージ本体を連結したもの)をコピーせずに、各断片の範囲を参照して送信する
+     * @param topic トピック
+     * @param header 通し番号ヘッダ(無効の場合は空)
+     * @param payload メッセージ本体
+     */
+    void publishFragments(std::string_view topic, std::string_view header, std::string_view payload)
+    {
+        const size_t overhead = topic.size() + kSeparator.size() + kFragmentHeaderSize;
+        const size_t frameSize = header.size() + payload.size();
+        if (overhead >= m_fragmentOptions.maxDatagramSize)
+        {
+            spdlog::warn("topic too long to fragment: " + std::string(topic));
+            return;
+        }
+        const size_t chunkSize = m_fragmentOptions.maxDatagramSize - overhead;
+        const size_t count = (frameSize + chunkSize - 1) / chunkSize;
+        if (count > UINT16_MAX || frameSize > UINT32_MAX)
+        {
+            spdlog::warn("frame too large to fragment (" + std::to_string(frameSize) + " bytes)");
+            return;
+        }
+        const uint32_t frameId = m_nextFrameId++;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const size_t offset = i * chunkSize;
+            const size_t length = std::min(chunkSize, frameSize - offset);
+            // 断片の範囲を、通し番号ヘッダ側とメッセージ本体側に分ける
+            const size_t headerPart = offset < header.size() ? std::min(length, header.size() - offset) : 0;
+            const std::string_view fromHeader = headerPart > 0 ? header.substr(offset, headerPart) : std::string_view{};
+            const size_t payloadOffset = offset + headerPart - header.size();
+            const std::string_view fromPayload = payload.substr(payloadOffset, length - headerPart);
+
+            char fragmentBuffer[kFragmentHeaderSize];
+            const FragmentHeader fragment{m_fragmentSenderId, frameId, static_cast<uint16_t>(i),
+                                          static_cast<uint16_t>(count), static_cast<uint32_t>(frameSize),
+                                          static_cast<uint32_t>(offset)};
+            const std::string_view parts[] = {topic, kSeparator, encodeFragmentHeader(fragmentBuffer, fragment),
+                                              fromHeader, fromPayload};
+            emit(parts, std::size(parts));
+        }
+        m_fragmentStats.framesSplit++;
+        m_fragmentStats.fragmentsSent += count;
+    }
+
+    /**
+     * @brief 前回の受信処理で再構成して返したフレームの領域を解放します
+     *
+     */
+    void releaseFrames()
+    {
+        if (m_reassembler)
+        {
+            m_reassembler->release();
+        }
+    }
+
+    /**
+     * @brief トピックの次の通し番号ヘッダを生成します
+     *
+     * @param topic トピックのID
+     * @param buffer ヘッダの書き込み先(kSequenceHeaderSizeバイト)
+     * @return std::string_view 生成したヘッダ
+     */
+    std::string_view nextSequenceHeader(TopicId topic, char *buffer)
+    {
+        const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count();
+        return encodeSequenceHeader(buffer, SequenceHeader{m_sendSequences[topic]++, now});
+    }
+
+    /**
+     * @brief データグラムをトピックとメッセージ本体に分割し、断片の再構成と通し番号の追跡を行います
+     * @details 再構成したフレームは、次の受信処理を呼び出すまで有効
+     * @param datagram 受信したデータグラム
+     * @param id トピックを検索した場合はそのID(検索しなかった場合は変更しない)
+     * @return TopicMessageView
+     */
+    TopicMessageView unwrap(std::string_view datagram, std::optional<TopicId> &id)
+    {
+        return unwrapMessage(splitTopicMessage(datagram), id);
+    }
+
+    /**
+     * @brief トピックとメッセージ本体に分割済みのメッセージについて、断片の再構成と通し番号の追跡を行います
+     *
+     * @details 通し番号を追跡する場合はトピックのIDを検索してidに返し、dispatchBatch()で同じトピックを再度検索しないようにする
+     * @param msg トピックとメッセージ本体
+     * @param id トピックを検索した場合はそのID(検索しなかった場合は変更しない)
+     * @return TopicMessageView ヘッダを取り除いたトピックとメッセージ本体(断片が揃っていない場合はメッセージ本体が空)
+     */
+    TopicMessageView unwrapMessage(TopicMessageView msg, std::optional<TopicId> &id)
+    {
+        if (m_reassembler)
+        {
+            if (auto fragment = decodeFragmentHeader(msg.second))
+            {
+                // 揃うまでは本体を空とし、呼び出し元で除外させる
+                auto frame = m_reassembler->add(msg.first, *fragment, msg.second);
+                msg.second = frame ? *frame : std::string_view{};
+            }
+        }
+        if (m_isSequencing)
+        {
+            if (auto header = decodeSequenceHeader(msg.second))
+            {
+                id = m_topics.find(msg.first);
+                m_sequenceTracker.record(*id, msg.first, *header);
+            }
         }
-        std::string a, b;
-        // a: 先頭0 から pos 文字分
-        a.assign(s, 0, pos);
-        // b: pos+1 から末尾まで
-        b.assign(s, pos + 1, s.size() - pos - 1);
-        return {a, b};
+        return msg;
     }
+
+private:
+    static constexpr std::string_view kSeparator{"\n"}; //! トピックとメッセージ本体の区切り文字
+
+    std::vector<TopicMessageView> m_topicBatch; //! 一括購読結果
+    std::vector<std::optional<TopicId>> m_topicBatchIds; //! 一括購読結果の各トピックのID(受信時に検索しなかった場合はstd::nullopt)
+    TopicRouter m_router;                       //! トピックフィルタごとのハンドラ
+    bool m_isSequencing{false};                 //! 通し番号ヘッダを付加・追跡するか
+    TopicRegistry m_topics;                     //! 登録したトピックとID
+    std::vector<TopicCounters> m_topicCounters; //! トピックのIDごとの送受信数
+    std::vector<uint64_t> m_sendSequences;      //! トピックのIDごとの次の送信通し番号
+    size_t m_topicLimit{kDefaultTopicLimit};    //! publish()が自動で登録するトピック数の上限
+    uint64_t m_unregisteredPublished{0};        //! 上限に達したため登録せずに発行したメッセージ数
+    SequenceTracker m_sequenceTracker;          //! 受信した通し番号の追跡結果
+    FragmentOptions m_fragmentOptions;          //! フレーム分割・再構成の構成オプション
+    FragmentStats m_fragmentStats;              //! フレーム分割・再構成の統計値
+    std::unique_ptr<FrameReassembler> m_reassembler; //! 断片の再構成処理(分割が無効の場合はnullptr)
+    uint32_t m_fragmentSenderId{0};             //! 分割ヘッダに付加する送信元番号(分割を有効にしたときに乱数で選ぶ)
+    uint32_t m_nextFrameId{0};                  //! 次に分割するフレームの番号
+    std::unique_ptr<EnvelopeBuilder> m_envelope; //! 送信待ちのエンベロープ(まとめて送信しない場合はnullptr)
+    std::vector<TopicMessageView> m_envelopeRecords; //! 受信したエンベロープから展開したメッセージ
+    size_t m_envelopeIndex{0};                  //! m_envelopeRecordsの次に返す位置
+    CoalesceStats m_coalesceStats;              //! メッセージをまとめて送受信した統計値
+    std::unique_ptr<Conflator> m_conflator;     //! トピックごとの間引き処理(無効の場合はnullptr)
+    std::unique_ptr<SendQueue> m_sendQueue;     //! 非同期発行用の送信キュー(トランスポートより先に破棄される)
+#ifndef _WIN32
+    std::unique_ptr<ShmRingWriter> m_ring;      //! 同一ホスト向けの共有メモリリング
+#endif
 };
+
+/**
+ * @brief UDPで送受信するMQTT中継
+ */
+using MqttBridge = BasicMqttBridge<UdpHandler>;
+
+#ifndef _WIN32
+/**
+ * @brief 同一ホスト内のAF_UNIXソケットで送受信するMQTT中継
+ */
+using UnixMqttBridge = BasicMqttBridge<UnixDatagramHandler>;
+#endif
 #endif // MQTT_HANDLER_HPP_
@@ -0,0 +1,365 @@
+/**
+ * @file PlotPointColumns.hpp
+ * @brief プロット点群を項目ごとの連続した配列(SoA)で保持するコンテナの定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef PLOT_POINT_COLUMNS_HPP_
+#define PLOT_POINT_COLUMNS_HPP_
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "PlotPoints.hpp"
+
+namespace plotmsg
+{
+    /**
+     * @brief 各列の先頭アドレスの境界[byte]
+     * @details キャッシュライン(64byte)に揃え、AVX-512の読み書きも境界をまたがないようにする
+     */
+    constexpr size_t kColumnAlignment = 64;
+
+    /**
+     * @brief 指定した境界に揃えて領域を確保するアロケータ
+     *
+     * @tparam T 要素の型
+     * @tparam Alignment 境界[byte](2のべき乗)
+     */
+    template <class T, size_t Alignment = kColumnAlignment>
+    class AlignedAllocator
+    {
+    public:
+        using value_type = T;
+        template <class U>
+        struct rebind
+        {
+            using other = AlignedAllocator<U, Alignment>;
+        };
+
+        AlignedAllocator() noexcept = default;
+        template <class U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+        T *allocate(size_t n)
+        {
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+            {
+                throw std::bad_array_new_length();
+            }
+            return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+        }
+        void deallocate(T *p, size_t) noexcept
+        {
+            ::operator delete(p, std::align_val_t(Alignment));
+        }
+
+        template <class U>
+        bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept { return true; }
+        template <class U>
+        bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept { return false; }
+    };
+
+    /**
+     * @brief プロット点群を、経路識別子・X・Y・Z座標ごとの連続した配列で保持するクラス
+     * @details PlotPoints(点ごとの構造体の配列)と異なり、各座標が連続して並ぶため、
+     * 座標ごとのループをコンパイラがベクトル化できる。各列の先頭はkColumnAlignmentに揃える。
+     * 座標の型はdouble(PlotPointColumns)またはfloat(PlotPointColumnsF)を選べる。
+     * PlotPointsとの相互変換、nlohmann::jsonとの相互変換(to_json/from_json)、
+     * JSON文字列への直接出力(dumpJson)に対応し、いずれもPlotPointsと同じ形式となる
+     * @tparam Real 座標の型(doubleまたはfloat)
+     */
+    template <class Real>
+    class BasicPlotPointColumns
+    {
+        static_assert(std::is_floating_point<Real>::value, "Real must be a floating point type");
+
+    public:
+        using value_type = Real;
+        template <class T>
+        using Column = std::vector<T, AlignedAllocator<T>>;
+
+        BasicPlotPointColumns() = default;
+
+        /**
+         * @brief PlotPointsから変換して構成します
+         *
+         * @param points 変換元の点群
+         */
+        explicit BasicPlotPointColumns(const PlotPoints &points)
+        {
+            assign(points);
+        }
+
+        /**
+         * @brief 点の数を返します
+         *
+         * @return size_t
+         */
+        size_t size() const { return m_ids.size(); }
+        bool empty() const { return m_ids.empty(); }
+
+        /**
+         * @brief 最低n点分の領域を確保します
+         *
+         * @param n 点の数
+         */
+        void reserve(size_t n)
+        {
+            m_ids.reserve(n);
+            m_xs.reserve(n);
+            m_ys.reserve(n);
+            m_zs.reserve(n);
+        }
+
+        /**
+         * @brief 点の数を変更します(追加した点は0で初期化する)
+         *
+         * @param n 点の数
+         */
+        void resize(size_t n)
+        {
+            m_ids.resize(n);
+            m_xs.resize(n);
+            m_ys.resize(n);
+            m_zs.resize(n);
+        }
+
+        /**
+         * @brief 全ての点を削除します(確保した領域は保持する)
+         *
+         */
+        void clear()
+        {
+            m_ids.clear();
+            m_xs.clear();
+            m_ys.clear();
+            m_zs.clear();
+        }
+
+        /**
+         * @brief 点を末尾に追加します
+         *
+         * @param id 経路識別子
+         * @param x X座標
+         * @param y Y座標
+         * @param z Z座標
+         */
+        void push_back(int64_t id, Real x, Real y, Real z)
+        {
+            m_ids.push_back(id);
+            m_xs.push_back(x);
+            m_ys.push_back(y);
+            m_zs.push_back(z);
+        }
+
+        /**
+         * @brief 経路識別子の列の先頭を返します(size()個の要素が連続する)
+         */
+        int64_t *id() { return m_ids.data(); }
+        const int64_t *id() const { return m_ids.data(); }
+
+        /**
+         * @brief X座標の列の先頭を返します(size()個の要素が連続する)
+         */
+        Real *x() { return m_xs.data(); }
+        const Real *x() const { return m_xs.data(); }
+
+        /**
+         * @brief Y座標の列の先頭を返します(size()個の要素が連続する)
+         */
+        Real *y() { return m_ys.data(); }
+        const Real *y() const { return m_ys.data(); }
+
+        /**
+         * @brief Z座標の列の先頭を返します(size()個の要素が連続する)
+         */
+        Real *z() { return m_zs.data(); }
+        const Real *z() const { return m_zs.data(); }
+
+        /**
+         * @brief プロット時間
+         */
+        double getTimestamp() const { return m_timestamp; }
+        void setTimestamp(double value) { m_timestamp = value; }
+
+        /**
+         * @brief PlotPointsの内容で置き換えます
+         * @details 確保済みの領域が足りる場合は、メモリ確保は発生しない
+         * @param points 変換元の点群
+         */
+        void assign(const PlotPoints &points)
+        {
+            const auto &source = points.getPoints();
+            resize(source.size());
+            for (size_t i = 0; i < source.size(); ++i)
+            {
+                m_ids[i] = source[i].getId();
+                m_xs[i] = static_cast<Real>(source[i].getX());
+                m_ys[i] = static_cast<Real>(source[i].getY());
+                m_zs[i] = static_cast<Real>(source[i].getZ());
+            }
+            m_timestamp = points.getTimestamp();
+        }
+
+        /**
+         * @brief PlotPointsに変換します
+         * @details 出力先の点の配列を再利用するため、容量が足りる場合はメモリ確保は発生しない
+         * @param points 出力先の点群
+         */
+        void toPlotPoints(PlotPoints &points) const
+        {
+            auto &target = points.getMutablePoints();
+            target.resize(size());
+            for (size_t i = 0; i < size(); ++i)
+            {
+                target[i].setId(m_ids[i]);
+                target[i].setX(static_cast<double>(m_xs[i]));
+                target[i].setY(static_cast<double>(m_ys[i]));
+                target[i].setZ(static_cast<double>(m_zs[i]));
+            }
+            points.setTimestamp(m_timestamp);
+        }
+
+        /**
+         * @brief PlotPointsに変換します
+         *
+         * @return PlotPoints
+         */
+        PlotPoints toPlotPoints() const
+        {
+            PlotPoints points;
+            toPlotPoints(points);
+            return points;
+        }
+
+        /**
+         * @brief JSON文字列を末尾に追加します
+         * @details nlohmann::jsonの中間表現を作らずに列から直接出力する。
+         * 出力はto_json()の結果をdump()した文字列と同じ(数値の書式もnlohmann::jsonと同じ。非有限値はnull)。
+         * 一致はtest/PlotPointColumnsTest.cppで確認している
+         * @param out 出力先
+         */
+        void dumpJson(std::string &out) const
+        {
+            out.reserve(out.size() + kJsonBytesPerPoint * size() + kJsonBytesFixed);
+            out += "{\"points\":[";
+            for (size_t i = 0; i < size(); ++i)
+            {
+                out += i == 0 ? "{\"id\":" : ",{\"id\":";
+                appendInteger(out, m_ids[i]);
+                out += ",\"x\":";
+                appendNumber(out, static_cast<double>(m_xs[i]));
+                out += ",\"y\":";
+                appendNumber(out, static_cast<double>(m_ys[i]));
+                out += ",\"z\":";
+                appendNumber(out, static_cast<double>(m_zs[i]));
+                out += '}';
+            }
+            out += "],\"timestamp\":";
+            appendNumber(out, m_timestamp);
+            out += '}';
+        }
+
+        /**
+         * @brief JSON文字列を返します
+         *
+         * @return std::string
+         */
+        std::string dumpJson() const
+        {
+            std::string out;
+            dumpJson(out);
+            return out;
+        }
+
+    private:
+        static constexpr size_t kJsonBytesPerPoint = 96; //! 1点あたりのJSON文字列の見積もり[byte]
+        static constexpr size_t kJsonBytesFixed = 48;    //! 点以外のJSON文字列の見積もり[byte]
+
+        static void appendInteger(std::string &out, int64_t value)
+        {
+            char buffer[24];
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+        }
+
+        static void appendNumber(std::string &out, double value)
+        {
+            if (!std::isfinite(value))
+            {
+                out += "null";
+                return;
+            }
+            // nlohmann::jsonのdump()と同じ書式(最短で往復変換できる桁数)にするため、同ライブラリの変換処理を使う
+            char buffer[64];
+            const char *end = nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, static_cast<size_t>(end - buffer));
+        }
+
+    private:
+        Column<int64_t> m_ids; //! 経路識別子
+        Column<Real> m_xs;     //! X座標
+        Column<Real> m_ys;     //! Y座標
+        Column<Real> m_zs;     //! Z座標
+        double m_timestamp{0}; //! プロット時間
+    };
+
+    /**
+     * @brief 座標を倍精度で保持する列形式の点群
+     */
+    using PlotPointColumns = BasicPlotPointColumns<double>;
+
+    /**
+     * @brief 座標を単精度で保持する列形式の点群(メモリ量と帯域が半分になる代わりに有効桁数は約7桁)
+     */
+    using PlotPointColumnsF = BasicPlotPointColumns<float>;
+
+    template <class Real>
+    void from_json(const json &j, BasicPlotPointColumns<Real> &x)
+    {
+        const auto &points = j.at("points");
+        x.clear();
+        x.reserve(points.size());
+        for (const auto &point : points)
+        {
+            x.push_back(point.at("id").get<int64_t>(),
+                        static_cast<Real>(point.at("x").get<double>()),
+                        static_cast<Real>(point.at("y").get<double>()),
+                        static_cast<Real>(point.at("z").get<double>()));
+        }
+        x.setTimestamp(j.at("timestamp").get<double>());
+    }
+
+    template <class Real>
+    void to_json(json &j, const BasicPlotPointColumns<Real> &x)
+    {
+        json points = json::array();
+        points.get_ref<json::array_t &>().reserve(x.size());
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            json point = json::object();
+            point["id"] = x.id()[i];
+            point["x"] = static_cast<double>(x.x()[i]);
+            point["y"] = static_cast<double>(x.y()[i]);
+            point["z"] = static_cast<double>(x.z()[i]);
+            points.push_back(std::move(point));
+        }
+        j = json::object();
+        j["points"] = std::move(points);
+        j["timestamp"] = x.getTimestamp();
+    }
+}
+
+#endif // PLOT_POINT_COLUMNS_HPP_
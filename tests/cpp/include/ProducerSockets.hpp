@@ -0,0 +1,327 @@
+/**
+ * @file ProducerSockets.hpp
+ * @brief 複数の送信スレッドがそれぞれ専用のソケットで送信するためのソケット集合の定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef PRODUCER_SOCKETS_HPP_
+#define PRODUCER_SOCKETS_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "spdlog/spdlog.h"
+#include "DatagramTransport.hpp"
+
+/**
+ * @brief 送信スレッドごとのソケットによる送信の統計値
+ */
+struct ProducerStats
+{
+    uint64_t threads{0};    //! 送信したことのあるスレッド数
+    uint64_t sockets{0};    //! 開いたソケット数(再接続を含む)
+    uint64_t sent{0};       //! 送信したメッセージ数
+    uint64_t sendErrors{0}; //! 送信に失敗したメッセージ数
+};
+
+/**
+ * @brief 送信スレッドごとに専用の接続済みソケットを割り当てて送信するクラス
+ * @details 各スレッドは初回の送信時にソケットを1つ受け取り(この時のみロックを取る)、以降は
+ * スレッドローカルの表から自分のソケットを引いてロックなしで送信する。ソケット、送信バッファ、
+ * カーネル内の送信経路をスレッド間で共有しないため、送信スレッド数に応じて送信処理がスケールする。
+ * スレッドが終了するとそのソケットを閉じ、送信状態は後から送信を始めたスレッドが再利用する。
+ * send()は任意のスレッドから同時に呼び出してよい。破棄は全ての送信スレッドがsend()を抜けてから行うこと
+ */
+class ProducerSockets
+{
+public:
+    /**
+     * @brief 送信先に接続したソケットを開く関数
+     * @details 失敗した場合はINVALID_SOCKを返し、引数にエラーコードを格納する
+     */
+    using Factory = std::function<socket_t(int &)>;
+
+    /**
+     * @brief 新しいソケット集合を構成します
+     * @details ソケットは各スレッドの初回の送信時に開く
+     * @param factory 送信先に接続したソケットを開く関数
+     */
+    explicit ProducerSockets(Factory factory)
+        : m_id(nextId()), m_factory(std::move(factory)), m_registry(std::make_shared<Registry>())
+    {
+    }
+
+    /**
+     * @brief ソケット集合を破棄し、全てのスレッドのソケットを閉じます
+     *
+     */
+    ~ProducerSockets()
+    {
+        std::lock_guard<std::mutex> lock(m_registry->mutex);
+        for (auto &slot : m_registry->slots)
+        {
+            if (slot->sock != INVALID_SOCK)
+            {
+                CLOSE_SOCKET(slot->sock);
+                slot->sock = INVALID_SOCK;
+            }
+        }
+    }
+
+    ProducerSockets(const ProducerSockets &) = delete;
+    ProducerSockets &operator=(const ProducerSockets &) = delete;
+
+    /**
+     * @brief 呼び出し元スレッドのソケットで、複数の領域を連結して1つのメッセージとして送信します
+     * @details ソケットが未接続の場合は接続する。接続が切れた場合(送信先の再起動など)はソケットを閉じ、次の送信で開き直す
+     * @param parts 送信する領域の配列
+     * @param count 領域の数(kMaxGatherParts以下)
+     * @return int 0:送信成功、それ以外:エラーコード
+     */
+    int send(const std::string_view *parts, size_t count)
+    {
+        if (count > kMaxGatherParts)
+        {
+            throw std::invalid_argument("sendConcurrent() supports up to " + std::to_string(kMaxGatherParts) + " parts");
+        }
+        Slot &slot = local();
+        int err = 0;
+        if (slot.sock == INVALID_SOCK)
+        {
+            slot.sock = m_factory(err);
+            if (slot.sock != INVALID_SOCK)
+            {
+                m_sockets.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (slot.sock != INVALID_SOCK)
+        {
+            err = sendParts(slot.sock, parts, count);
+        }
+        if (err == 0)
+        {
+            bump(slot.sent);
+            return 0;
+        }
+        bump(slot.sendErrors);
+        if (slot.sock != INVALID_SOCK && err != EMSGSIZE && err != EAGAIN && err != EWOULDBLOCK)
+        {
+            CLOSE_SOCKET(slot.sock);
+            slot.sock = INVALID_SOCK;
+        }
+        // 送信先が停止している間は毎回失敗するため、ログ出力はスレッドごとに1,2,4,8...回目のみに抑える
+        const uint64_t errors = slot.sendErrors.load(std::memory_order_relaxed);
+        if ((errors & (errors - 1)) == 0)
+        {
+            spdlog::warn("concurrent send failed: " + std::to_string(err) +
+                         " (total " + std::to_string(errors) + " on this thread)");
+        }
+        return err;
+    }
+
+    /**
+     * @brief 全スレッドの統計値の合計を返します
+     * @details 送信中に呼び出した場合は、各スレッドの値をそれぞれ異なる時点で読み取る
+     * @return ProducerStats
+     */
+    ProducerStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_registry->mutex);
+        ProducerStats stats;
+        stats.threads = m_registry->threads;
+        stats.sockets = m_sockets.load(std::memory_order_relaxed);
+        for (const auto &slot : m_registry->slots)
+        {
+            stats.sent += slot->sent.load(std::memory_order_relaxed);
+            stats.sendErrors += slot->sendErrors.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    static constexpr size_t kMaxGatherParts = 8; //! send()で連結できる最大領域数
+
+private:
+    /**
+     * @brief スレッドごとの送信状態
+     * @details 他のスレッドの状態と同じキャッシュラインに載らないように配置する
+     */
+    struct alignas(64) Slot
+    {
+        socket_t sock{INVALID_SOCK};      //! スレッド専用の接続済みソケット
+        std::atomic<uint64_t> sent{0};       //! 送信したメッセージ数(書き込みは所有スレッドのみ)
+        std::atomic<uint64_t> sendErrors{0}; //! 送信に失敗したメッセージ数(書き込みは所有スレッドのみ)
+    };
+
+    /**
+     * @brief スレッドごとの送信状態の一覧
+     * @details ソケット集合とスレッドローカルの表で共有し、ソケット集合の破棄後に終了したスレッドも安全に参照できるようにする
+     */
+    struct Registry
+    {
+        std::mutex mutex;                         //! 以下の保護(スレッドの初回の送信時と終了時のみ取る)
+        std::vector<std::unique_ptr<Slot>> slots; //! スレッドごとの送信状態
+        std::vector<Slot *> idle;                 //! 終了したスレッドの送信状態(ソケットは閉じてある)
+        uint64_t threads{0};                      //! 送信したことのあるスレッド数
+    };
+
+    /**
+     * @brief スレッドローカルの表の要素
+     * @details idはソケット集合ごとに一意なため、破棄されたソケット集合のアドレスが再利用されても取り違えない
+     */
+    struct CacheEntry
+    {
+        uint64_t id;                   //! ソケット集合の識別番号
+        Slot *slot;                    //! 呼び出し元スレッドの送信状態
+        std::weak_ptr<Registry> owner; //! ソケット集合の送信状態の一覧(破棄済みの要素の削除に使う)
+    };
+
+    /**
+     * @brief スレッドローカルの表
+     * @details スレッドの終了時に、そのスレッドのソケットを閉じて送信状態を返却する
+     */
+    struct ThreadCache
+    {
+        std::vector<CacheEntry> entries;
+
+        ~ThreadCache()
+        {
+            for (const auto &entry : entries)
+            {
+                if (auto registry = entry.owner.lock())
+                {
+                    std::lock_guard<std::mutex> lock(registry->mutex);
+                    if (entry.slot->sock != INVALID_SOCK)
+                    {
+                        CLOSE_SOCKET(entry.slot->sock);
+                        entry.slot->sock = INVALID_SOCK;
+                    }
+                    registry->idle.push_back(entry.slot);
+                }
+            }
+        }
+    };
+
+    static uint64_t nextId()
+    {
+        static std::atomic<uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 所有スレッドのみが書き込むカウンタを加算します(ロック付き命令を使わない)
+     *
+     * @param counter カウンタ
+     */
+    static void bump(std::atomic<uint64_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 呼び出し元スレッドの送信状態を返します
+     * @details 初回のみロックを取って送信状態を割り当て(終了したスレッドのものがあれば再利用する)、
+     * スレッドローカルの表に登録する
+     * @return Slot&
+     */
+    Slot &local()
+    {
+        thread_local ThreadCache cache;
+        for (const auto &entry : cache.entries)
+        {
+            if (entry.id == m_id)
+            {
+                return *entry.slot;
+            }
+        }
+        // 破棄済みのソケット集合の要素を取り除く
+        cache.entries.erase(std::remove_if(cache.entries.begin(), cache.entries.end(),
+                                           [](const CacheEntry &entry)
+                                           { return entry.owner.expired(); }),
+                            cache.entries.end());
+        Slot *slot = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_registry->mutex);
+            m_registry->threads++;
+            if (!m_registry->idle.empty())
+            {
+                slot = m_registry->idle.back();
+                m_registry->idle.pop_back();
+            }
+            else
+            {
+                m_registry->slots.push_back(std::make_unique<Slot>());
+                slot = m_registry->slots.back().get();
+            }
+        }
+        cache.entries.push_back(CacheEntry{m_id, slot, m_registry});
+        return *slot;
+    }
+
+    /**
+     * @brief 接続済みソケットで複数の領域を連結して送信します
+     *
+     * @param sock 送信ソケット
+     * @param parts 送信する領域の配列
+     * @param count 領域の数
+     * @return int 0:送信成功、それ以外:エラーコード
+     */
+    static int sendParts(socket_t sock, const std::string_view *parts, size_t count)
+    {
+#ifdef _WIN32
+        WSABUF bufs[kMaxGatherParts];
+        for (size_t i = 0; i < count; ++i)
+        {
+            bufs[i].buf = const_cast<CHAR *>(parts[i].data());
+            bufs[i].len = static_cast<ULONG>(parts[i].size());
+        }
+        DWORD sentBytes = 0;
+        if (WSASend(sock, bufs, static_cast<DWORD>(count), &sentBytes, 0, nullptr, nullptr) == SOCK_ERR)
+        {
+            return GET_ERROR();
+        }
+        return 0;
+#else
+        iovec iov[kMaxGatherParts];
+        for (size_t i = 0; i < count; ++i)
+        {
+            iov[i].iov_base = const_cast<char *>(parts[i].data());
+            iov[i].iov_len = parts[i].size();
+        }
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        int flags = 0;
+#ifdef MSG_NOSIGNAL
+        flags |= MSG_NOSIGNAL;
+#endif
+        while (sendmsg(sock, &msg, flags) == SOCK_ERR)
+        {
+            const int err = GET_ERROR();
+            if (err != EINTR)
+            {
+                return err;
+            }
+        }
+        return 0;
+#endif
+    }
+
+private:
+    const uint64_t m_id;                       //! ソケット集合の識別番号(プロセス内で一意)
+    Factory m_factory;                         //! ソケットを開く関数
+    std::shared_ptr<Registry> m_registry;      //! スレッドごとの送信状態の一覧(スレッドローカルの表は弱参照を持つ)
+    std::atomic<uint64_t> m_sockets{0};        //! 開いたソケット数
+};
+
+#endif // PRODUCER_SOCKETS_HPP_
@@ -0,0 +1,406 @@
+/**
+ * @file SendQueue.hpp
+ * @brief 送信を呼び出し元スレッドから切り離す有界送信キューの定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef SEND_QUEUE_HPP_
+#define SEND_QUEUE_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "spdlog/spdlog.h"
+#include "DatagramTransport.hpp"
+
+/**
+ * @brief キューが満杯のときの動作
+ */
+enum class OverflowPolicy
+{
+    DropOldest,       //! 最も古いメッセージを破棄して追加する
+    DropNewest,       //! 追加しようとしたメッセージを破棄する
+    BlockWithTimeout, //! 空きができるまで最大blockTimeoutだけ待ち、空かなければ破棄する
+};
+
+/**
+ * @brief 送信キューの構成オプション
+ */
+struct SendQueueOptions
+{
+    size_t capacity{256};                          //! キューに保持できる最大メッセージ数
+    OverflowPolicy policy{OverflowPolicy::DropOldest}; //! キューが満杯のときの動作
+    std::chrono::milliseconds blockTimeout{10};    //! BlockWithTimeoutで空きを待つ最大時間
+    size_t batchSize{32};                          //! 1回の送信処理でまとめて送信する最大メッセージ数
+    bool drainThread{true};                        //! 送信専用スレッドを起動するか(falseの場合はdrain()を呼び出して送信する)
+};
+
+/**
+ * @brief 送信キューの統計値
+ */
+struct SendQueueStats
+{
+    uint64_t enqueued{0};      //! キューに追加したメッセージ数
+    uint64_t sent{0};          //! 送信したメッセージ数
+    uint64_t sendErrors{0};    //! 送信に失敗したメッセージ数
+    uint64_t deferred{0};      //! 送信バッファが満杯のため、キューの先頭に戻して後で送信し直したメッセージ数
+    uint64_t droppedOldest{0}; //! DropOldestにより破棄したメッセージ数
+    uint64_t droppedNewest{0}; //! DropNewestにより破棄したメッセージ数
+    uint64_t timedOut{0};      //! BlockWithTimeoutで空きを待ちきれず破棄したメッセージ数
+    size_t depth{0};           //! 現在キューに溜まっているメッセージ数
+    size_t highWatermark{0};   //! キューに溜まったメッセージ数の最大値
+};
+
+/**
+ * @brief トランスポート(UdpHandlerなど)への送信を非同期に行う有界キュー
+ * @details push()はメッセージをあらかじめ確保したスロットにコピーして直ちに戻るため、
+ * 送信バッファの満杯や送信経路の遅延で呼び出し元(シミュレーションの周期処理など)が停止しない。
+ * キューに溜まったメッセージは送信専用スレッド、またはdrain()の呼び出しでsendBatch()によりまとめて送信する。
+ * 送信バッファが満杯(EAGAIN)で送信できなかったメッセージは失敗とせずにキューの先頭へ戻し、
+ * 送信専用スレッドはソケットが送信可能になるまで待ってから送信し直す(戻す空きが無い場合は最も古いものとして破棄する)。
+ * 送信専用スレッドの動作中は、対象のトランスポートの送信処理を他のスレッドから呼び出さないこと
+ */
+class SendQueue
+{
+public:
+    /**
+     * @brief 新しい送信キューを構成します
+     *
+     * @param target 送信に使用するトランスポート(キューより長く存在すること)
+     * @param options 構成オプション
+     */
+    explicit SendQueue(DatagramTransport &target, const SendQueueOptions &options = SendQueueOptions{})
+        : m_target(target), m_options(options), m_slots(options.capacity), m_inflight(options.batchSize)
+    {
+        if (options.capacity == 0 || options.batchSize == 0)
+        {
+            throw std::invalid_argument("capacity and batchSize must be positive");
+        }
+        if (options.drainThread)
+        {
+            m_thread = std::thread([this]()
+                                   { work(); });
+        }
+    }
+
+    /**
+     * @brief 送信キューを破棄します
+     * @details 送信専用スレッドを使用している場合は、キューに残ったメッセージを送信してから停止する
+     */
+    ~SendQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopping = true;
+        }
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    SendQueue(const SendQueue &) = delete;
+    SendQueue &operator=(const SendQueue &) = delete;
+
+    /**
+     * @brief メッセージをキューに追加します
+     *
+     * @param payload 送信するデータグラム
+     * @return true 追加成功
+     * @return false キューが満杯のため破棄した
+     */
+    bool push(std::string_view payload)
+    {
+        return push({payload});
+    }
+
+    /**
+     * @brief 複数の領域を連結した1つのメッセージをキューに追加します
+     * @details 連結結果はスロットに直接書き込むため、スロットの容量が足りていればメモリ確保は発生しない
+     * @param parts 連結する領域の並び
+     * @return true 追加成功
+     * @return false キューが満杯のため破棄した
+     */
+    bool push(std::initializer_list<std::string_view> parts)
+    {
+        return push(parts.begin(), parts.size());
+    }
+
+    /**
+     * @brief 複数の領域を連結した1つのメッセージをキューに追加します
+     *
+     * @param parts 連結する領域の配列
+     * @param count 領域の数
+     * @return true 追加成功
+     * @return false キューが満杯のため破棄した
+     */
+    bool push(const std::string_view *parts, size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_count == m_slots.size())
+        {
+            switch (m_options.policy)
+            {
+            case OverflowPolicy::DropOldest:
+                m_head = (m_head + 1) % m_slots.size();
+                m_count--;
+                m_stats.droppedOldest++;
+                break;
+            case OverflowPolicy::DropNewest:
+                m_stats.droppedNewest++;
+                return false;
+            case OverflowPolicy::BlockWithTimeout:
+                if (!m_notFull.wait_for(lock, m_options.blockTimeout, [this]()
+                                        { return m_count < m_slots.size() || m_isStopping; }) ||
+                    m_count == m_slots.size())
+                {
+                    m_stats.timedOut++;
+                    return false;
+                }
+                break;
+            }
+        }
+        std::string &slot = m_slots[(m_head + m_count) % m_slots.size()];
+        slot.clear();
+        for (size_t i = 0; i < count; ++i)
+        {
+            slot.append(parts[i].data(), parts[i].size());
+        }
+        m_count++;
+        m_stats.enqueued++;
+        m_stats.highWatermark = std::max(m_stats.highWatermark, m_count);
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief キューに溜まったメッセージを送信します
+     * @details drainThreadを無効にした場合に、EventReactorの周期処理などから呼び出す。待機はしない。
+     * 送信バッファが満杯になった時点で、残りをキューに残して戻る(次の呼び出しで送信する)。
+     * 送信用のバッファを共有するため、他のスレッドがdrain()を実行中の場合や再入した場合は何もせずに0を返す
+     * @param maxCount 送信する最大メッセージ数
+     * @return size_t 取り出して送信処理を終えたメッセージ数(失敗を含み、キューに戻したものを含まない)
+     */
+    size_t drain(size_t maxCount = SIZE_MAX)
+    {
+        if (m_options.drainThread)
+        {
+            throw std::logic_error("drain() cannot be used with the drain thread");
+        }
+        std::unique_lock<std::mutex> drainLock(m_drainMutex, std::try_to_lock);
+        if (!drainLock.owns_lock())
+        {
+            return 0;
+        }
+        size_t total = 0;
+        while (total < maxCount)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            bool deferred = false;
+            const size_t done = sendSome(lock, maxCount - total, deferred);
+            total += done;
+            if (done == 0 || deferred)
+            {
+                break;
+            }
+        }
+        return total;
+    }
+
+    /**
+     * @brief 現在キューに溜まっているメッセージ数を返します
+     *
+     * @return size_t
+     */
+    size_t depth() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count;
+    }
+
+    /**
+     * @brief 統計値を返します
+     *
+     * @return SendQueueStats
+     */
+    SendQueueStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        SendQueueStats stats = m_stats;
+        stats.depth = m_count;
+        return stats;
+    }
+
+    /**
+     * @brief 構成オプションを返します
+     *
+     * @return const SendQueueOptions&
+     */
+    const SendQueueOptions &options() const { return m_options; }
+
+private:
+    /**
+     * @brief 送信専用スレッドの処理
+     * @details 停止要求後もキューが空になるまで送信を続ける
+     */
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_notEmpty.wait(lock, [this]()
+                            { return m_count > 0 || m_isStopping; });
+            if (m_count == 0)
+            {
+                return;
+            }
+            bool deferred = false;
+            sendSome(lock, m_inflight.size(), deferred);
+            if (deferred)
+            {
+                waitWritable(m_target.sendSocket(), kWritableWaitMs);
+            }
+            lock.lock();
+        }
+    }
+
+    /**
+     * @brief ソケットが送信可能になるまで待機します
+     *
+     * @param sock 送信ソケット
+     * @param timeoutMs 最大待機時間[msec]
+     */
+    static void waitWritable(socket_t sock, int timeoutMs)
+    {
+#ifdef _WIN32
+        fd_set writefds;
+        FD_ZERO(&writefds);
+        FD_SET(sock, &writefds);
+        timeval tv;
+        tv.tv_sec = timeoutMs / 1000;
+        tv.tv_usec = (timeoutMs % 1000) * 1000;
+        if (select(static_cast<int>(sock + 1), nullptr, &writefds, nullptr, &tv) == SOCK_ERR)
+        {
+            spdlog::error("select() failed: " + std::to_string(GET_ERROR()));
+        }
+#else
+        pollfd pfd{sock, POLLOUT, 0};
+        if (poll(&pfd, 1, timeoutMs) == SOCK_ERR && GET_ERROR() != EINTR)
+        {
+            spdlog::error("poll() failed: " + std::to_string(GET_ERROR()));
+        }
+#endif
+    }
+
+    /**
+     * @brief キューの先頭から最大maxCount件を取り出して送信します
+     * @details 取り出したスロットは送信用のバッファと交換するため、文字列のコピーやメモリ確保は発生しない。
+     * 送信バッファが満杯で送信できなかったメッセージは、元の順序のままキューの先頭に戻す。
+     * 送信中はロックを解放し、戻る時点でロックは解放されている
+     * @param lock 取得済みのロック
+     * @param maxCount 送信する最大メッセージ数
+     * @param deferred キューの先頭に戻したメッセージがあった場合にtrueを格納する
+     * @return size_t 送信処理を終えたメッセージ数(失敗を含み、キューに戻したものを含まない)
+     */
+    size_t sendSome(std::unique_lock<std::mutex> &lock, size_t maxCount, bool &deferred)
+    {
+        const size_t count = std::min({m_count, maxCount, m_inflight.size()});
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_inflight[i].swap(m_slots[m_head]);
+            m_head = (m_head + 1) % m_slots.size();
+        }
+        m_count -= count;
+        lock.unlock();
+        if (count == 0)
+        {
+            return 0;
+        }
+        m_notFull.notify_all();
+
+        m_batch.clear();
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_batch.add(m_inflight[i]);
+        }
+        const auto result = m_target.sendBatch(m_batch);
+
+        lock.lock();
+        // 送信バッファが満杯で送れなかったメッセージは、後ろから順にキューの先頭へ戻して順序を保つ
+        // (停止中は送信可能になる保証が無いため戻さない)
+        size_t requeued = 0;
+        size_t dropped = 0;
+        int firstError = 0;
+        for (size_t i = count; i-- > 0;)
+        {
+            const int error = m_batch[i].error;
+            if (m_batch[i].sent)
+            {
+                continue;
+            }
+            if ((error != EAGAIN && error != EWOULDBLOCK) || m_isStopping)
+            {
+                firstError = error;
+                continue;
+            }
+            if (m_count == m_slots.size())
+            {
+                dropped++;
+                continue;
+            }
+            m_head = (m_head + m_slots.size() - 1) % m_slots.size();
+            m_slots[m_head].swap(m_inflight[i]);
+            m_count++;
+            requeued++;
+        }
+        m_stats.sent += result.sentCount;
+        m_stats.sendErrors += result.failedCount - requeued - dropped;
+        m_stats.deferred += requeued;
+        m_stats.droppedOldest += dropped;
+        const uint64_t failures = m_stats.sendErrors;
+        lock.unlock();
+        deferred = requeued > 0 || dropped > 0;
+        const size_t failed = result.failedCount - requeued - dropped;
+        if (failed > 0)
+        {
+            spdlog::warn("SendQueue failed to send " + std::to_string(failed) +
+                         " messages: " + std::to_string(firstError) + " (total " + std::to_string(failures) + ")");
+        }
+        return count - requeued;
+    }
+
+private:
+    static constexpr int kWritableWaitMs = 10; //! 送信バッファが満杯のとき、送信可能になるのを待つ最大時間[msec]
+
+    DatagramTransport &m_target;       //! 送信に使用するトランスポート
+    SendQueueOptions m_options;        //! 構成オプション
+    std::vector<std::string> m_slots;  //! 送信待ちメッセージのリングバッファ
+    std::vector<std::string> m_inflight; //! 送信中のメッセージ(スロットと交換して使用)
+    SendBatch m_batch;                 //! 一括送信の要求
+    size_t m_head{0};                  //! リングバッファの先頭位置
+    size_t m_count{0};                 //! リングバッファに溜まっているメッセージ数
+    bool m_isStopping{false};          //! 停止要求
+    SendQueueStats m_stats;            //! 統計値
+    mutable std::mutex m_mutex;        //! キューの排他制御
+    std::mutex m_drainMutex;           //! drain()の同時実行・再入の防止(m_inflightとm_batchを保護する)
+    std::condition_variable m_notEmpty; //! メッセージ追加の通知
+    std::condition_variable m_notFull;  //! 空き発生の通知
+    std::thread m_thread;              //! 送信専用スレッド
+};
+
+#endif // SEND_QUEUE_HPP_
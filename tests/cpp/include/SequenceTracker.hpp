@@ -0,0 +1,430 @@
+/**
+ * @file SequenceTracker.hpp
+ * @brief トピックごとの通し番号による欠落・重複・順序入れ替わりの検出の定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef SEQUENCE_TRACKER_HPP_
+#define SEQUENCE_TRACKER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "LatencyHistogram.hpp"
+#include "TopicRegistry.hpp"
+
+/**
+ * @brief 通し番号ヘッダの先頭を示す識別子
+ * @details メッセージ本体(JSON)の先頭に現れない制御文字で始める
+ */
+constexpr std::string_view kSequenceMagic{"\x1fSQ"};
+
+/**
+ * @brief 通し番号ヘッダのバイト数(識別子、通し番号8バイト、送信時刻8バイト)
+ */
+constexpr size_t kSequenceHeaderSize = 3 + 8 + 8;
+
+/**
+ * @brief メッセージ本体の先頭に付加する通し番号ヘッダ
+ * @details 数値はネットワークバイトオーダ(ビッグエンディアン)で格納する
+ */
+struct SequenceHeader
+{
+    uint64_t sequence{0}; //! トピックごとの通し番号(0から始まる)
+    int64_t sendTimeNs{0}; //! 送信時刻(UNIXエポックからの経過時間[nsec])
+};
+
+/**
+ * @brief 通し番号ヘッダをバッファに書き込みます
+ *
+ * @param out 書き込み先(kSequenceHeaderSizeバイト)
+ * @param header 通し番号ヘッダ
+ * @return std::string_view 書き込んだヘッダ
+ */
+inline std::string_view encodeSequenceHeader(char *out, const SequenceHeader &header)
+{
+    std::memcpy(out, kSequenceMagic.data(), kSequenceMagic.size());
+    const uint64_t values[] = {header.sequence, static_cast<uint64_t>(header.sendTimeNs)};
+    char *p = out + kSequenceMagic.size();
+    for (uint64_t value : values)
+    {
+        for (int shift = 56; shift >= 0; shift -= 8)
+        {
+            *p++ = static_cast<char>((value >> shift) & 0xff);
+        }
+    }
+    return std::string_view(out, kSequenceHeaderSize);
+}
+
+/**
+ * @brief メッセージ本体の先頭の通し番号ヘッダを読み取り、取り除きます
+ *
+ * @param payload メッセージ本体(ヘッダがある場合はヘッダを除いた範囲に更新する)
+ * @return std::optional<SequenceHeader> 通し番号ヘッダ(無い場合はstd::nullopt)
+ */
+inline std::optional<SequenceHeader> decodeSequenceHeader(std::string_view &payload)
+{
+    if (payload.size() < kSequenceHeaderSize || payload.substr(0, kSequenceMagic.size()) != kSequenceMagic)
+    {
+        return std::nullopt;
+    }
+    uint64_t values[2] = {0, 0};
+    const char *p = payload.data() + kSequenceMagic.size();
+    for (auto &value : values)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            value = (value << 8) | static_cast<unsigned char>(*p++);
+        }
+    }
+    payload.remove_prefix(kSequenceHeaderSize);
+    return SequenceHeader{values[0], static_cast<int64_t>(values[1])};
+}
+
+/**
+ * @brief 通し番号の追跡結果
+ */
+struct SequenceStats
+{
+    uint64_t received{0};        //! 受信したメッセージ数(重複を含む)
+    uint64_t expected{0};        //! 最初の受信から最新の通し番号までに送信されたはずのメッセージ数
+    uint64_t missing{0};         //! まだ届いていないメッセージ数(欠落とみなす)
+    uint64_t gaps{0};            //! 通し番号が飛んだ回数
+    uint64_t duplicates{0};      //! 重複して受信したメッセージ数
+    uint64_t reordered{0};       //! 後続より遅れて届いたメッセージ数
+    uint64_t restarts{0};        //! 通し番号が戻ったのに送信時刻が進んでいたため、送信側の再起動とみなした回数
+    uint64_t lateBeforeStart{0}; //! 追跡開始(再起動を含む)時の通し番号より前の、遅れて届いたメッセージ数(欠落数には含めない)
+    uint64_t stale{0};           //! 追跡範囲(kSequenceWindow)より古く、重複か判定できなかった遅延メッセージ数
+    uint64_t maxReorderDepth{0}; //! 遅れて届いたメッセージの、最新の通し番号との差の最大値
+
+    /**
+     * @brief 欠落率を返します
+     *
+     * @return double 0～1(未受信の場合は0)
+     */
+    double lossRate() const
+    {
+        return expected == 0 ? 0.0 : static_cast<double>(missing) / static_cast<double>(expected);
+    }
+
+    /**
+     * @brief ログ出力用の要約文字列を返します
+     *
+     * @return std::string
+     */
+    std::string summary() const
+    {
+        return "received=" + std::to_string(received) +
+               " missing=" + std::to_string(missing) +
+               " lossRate=" + std::to_string(lossRate()) +
+               " gaps=" + std::to_string(gaps) +
+               " duplicates=" + std::to_string(duplicates) +
+               " reordered=" + std::to_string(reordered) +
+               " restarts=" + std::to_string(restarts) +
+               " lateBeforeStart=" + std::to_string(lateBeforeStart) +
+               " stale=" + std::to_string(stale) +
+               " maxReorderDepth=" + std::to_string(maxReorderDepth);
+    }
+};
+
+/**
+ * @brief 重複・順序入れ替わりを判定する通し番号の範囲(最新の通し番号からの差)
+ */
+constexpr uint64_t kSequenceWindow = 1024;
+
+/**
+ * @brief トピックごとの通し番号から、欠落・重複・順序入れ替わりを検出するクラス
+ * @details 最新の通し番号からkSequenceWindow件分の受信状況をビットマップで保持する。
+ * 通し番号が戻ったときは送信時刻と比べ、最新の通し番号の送信時刻より新しければ送信側の再起動、
+ * 古ければ遅延とみなす。追跡開始時の通し番号より前の遅延メッセージは欠落数に影響しない。
+ * TopicRegistryに登録済みのトピックの状態はIDを添字とする配列で、未登録のトピックの状態はトピック名の表で保持する。
+ * メモリ確保は新しいトピックを初めて受信したときのみ発生する。スレッドセーフではない
+ */
+class SequenceTracker
+{
+public:
+    /**
+     * @brief 受信したメッセージの通し番号を記録します
+     *
+     * @param topic トピック
+     * @param header 受信したメッセージの通し番号ヘッダ
+     */
+    void record(std::string_view topic, const SequenceHeader &header)
+    {
+        record(kInvalidTopicId, topic, header);
+    }
+
+    /**
+     * @brief 受信したメッセージの通し番号を記録します
+     * @details 登録済みのトピックは、トピック名を検索せずにIDを添字として状態を参照する
+     * @param id トピックのID(未登録の場合はkInvalidTopicId)
+     * @param topic トピック
+     * @param header 受信したメッセージの通し番号ヘッダ
+     */
+    void record(TopicId id, std::string_view topic, const SequenceHeader &header)
+    {
+        TopicState &state = id == kInvalidTopicId ? namedState(topic) : idState(id, topic);
+        const SequenceStats before = state.stats;
+        update(state, header);
+        accumulate(before, state.stats);
+
+        const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count();
+        m_transitDelay.record(now - header.sendTimeNs);
+    }
+
+    /**
+     * @brief 全トピックの追跡結果の合計を返します
+     *
+     * @return const SequenceStats&
+     */
+    const SequenceStats &total() const { return m_total; }
+
+    /**
+     * @brief トピックの追跡結果を返します
+     *
+     * @param topic トピック
+     * @return const SequenceStats* 追跡結果(受信していないトピックの場合はnullptr)
+     */
+    const SequenceStats *topic(std::string_view topic) const
+    {
+        auto it = m_topics.find(topic);
+        if (it != m_topics.end())
+        {
+            return &it->second.stats;
+        }
+        for (const auto &state : m_topicsById)
+        {
+            if (state.started && state.name == topic)
+            {
+                return &state.stats;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief 登録済みのトピックの追跡結果を返します
+     *
+     * @param id トピックのID
+     * @return const SequenceStats* 追跡結果(受信していないトピックの場合はnullptr)
+     */
+    const SequenceStats *topic(TopicId id) const
+    {
+        return id < m_topicsById.size() && m_topicsById[id].started ? &m_topicsById[id].stats : nullptr;
+    }
+
+    /**
+     * @brief 送信時刻から受信処理までの経過時間の分布を返します
+     * @details 送信側と受信側の時計のずれを含む(別ホストの場合は時刻同期が必要)
+     * @return const LatencyHistogram&
+     */
+    const LatencyHistogram &transitDelay() const { return m_transitDelay; }
+
+    /**
+     * @brief 追跡結果を初期化します
+     *
+     */
+    void reset()
+    {
+        m_topics.clear();
+        m_topicsById.clear();
+        m_total = SequenceStats{};
+        m_transitDelay.reset();
+    }
+
+private:
+    static constexpr size_t kWindowWords = kSequenceWindow / 64;
+
+    /**
+     * @brief トピックごとの追跡状態
+     */
+    struct TopicState
+    {
+        bool started{false};                        //! 受信済みか
+        uint64_t lowest{0};                         //! 追跡開始(再起動を含む)時の通し番号
+        uint64_t highest{0};                        //! 受信した最新の通し番号
+        int64_t highestSendTimeNs{0};               //! 最新の通し番号の送信時刻
+        std::array<uint64_t, kWindowWords> seen{};  //! 最新kSequenceWindow件の受信状況(通し番号 % kSequenceWindowの位置)
+        SequenceStats stats;                        //! 追跡結果
+        std::string name;                           //! トピック(IDで参照する状態のみ)
+    };
+
+    /**
+     * @brief 未登録のトピックの追跡状態を返します(初回は作成する)
+     *
+     * @param topic トピック
+     * @return TopicState&
+     */
+    TopicState &namedState(std::string_view topic)
+    {
+        auto it = m_topics.find(topic);
+        if (it == m_topics.end())
+        {
+            it = m_topics.emplace(std::string(topic), TopicState{}).first;
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief 登録済みのトピックの追跡状態を返します(初回は作成する)
+     * @details 登録前に受信していたトピックは、トピック名の表の状態を引き継ぐ
+     * @param id トピックのID
+     * @param topic トピック
+     * @return TopicState&
+     */
+    TopicState &idState(TopicId id, std::string_view topic)
+    {
+        if (id >= m_topicsById.size())
+        {
+            m_topicsById.resize(static_cast<size_t>(id) + 1);
+        }
+        TopicState &state = m_topicsById[id];
+        if (!state.started && state.stats.received == 0)
+        {
+            auto it = m_topics.find(topic);
+            if (it != m_topics.end())
+            {
+                state = it->second;
+                m_topics.erase(it);
+            }
+            state.name = std::string(topic);
+        }
+        return state;
+    }
+
+    static bool test(const TopicState &state, uint64_t sequence)
+    {
+        const uint64_t bit = sequence % kSequenceWindow;
+        return (state.seen[bit / 64] >> (bit % 64)) & 1u;
+    }
+    static void set(TopicState &state, uint64_t sequence)
+    {
+        const uint64_t bit = sequence % kSequenceWindow;
+        state.seen[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+    static void clear(TopicState &state, uint64_t sequence)
+    {
+        const uint64_t bit = sequence % kSequenceWindow;
+        state.seen[bit / 64] &= ~(uint64_t{1} << (bit % 64));
+    }
+
+    /**
+     * @brief 通し番号を1件記録し、トピックの追跡結果を更新します
+     *
+     * @param state トピックの追跡状態
+     * @param header 受信した通し番号ヘッダ
+     */
+    static void update(TopicState &state, const SequenceHeader &header)
+    {
+        SequenceStats &stats = state.stats;
+        const uint64_t sequence = header.sequence;
+        stats.received++;
+        if (state.started && sequence <= state.highest && header.sendTimeNs > state.highestSendTimeNs)
+        {
+            // 戻った通し番号が最新より後に送信されていれば、遅延ではなく送信側の再起動とみなして追跡をやり直す
+            stats.restarts++;
+            state.started = false;
+        }
+        if (!state.started)
+        {
+            state.started = true;
+            state.lowest = sequence;
+            state.highest = sequence;
+            state.highestSendTimeNs = header.sendTimeNs;
+            state.seen.fill(0);
+            set(state, sequence);
+            stats.expected++;
+            return;
+        }
+        if (sequence > state.highest)
+        {
+            const uint64_t skipped = sequence - state.highest - 1;
+            if (skipped > 0)
+            {
+                stats.gaps++;
+                stats.missing += skipped;
+            }
+            stats.expected += sequence - state.highest;
+            // 範囲外に出る位置を未受信に戻す
+            if (sequence - state.highest >= kSequenceWindow)
+            {
+                state.seen.fill(0);
+            }
+            else
+            {
+                for (uint64_t s = state.highest + 1; s < sequence; ++s)
+                {
+                    clear(state, s);
+                }
+            }
+            state.highest = sequence;
+            state.highestSendTimeNs = header.sendTimeNs;
+            set(state, sequence);
+            return;
+        }
+        if (sequence < state.lowest)
+        {
+            // 追跡開始前に送信されたメッセージは、expected/missingに数えていない
+            stats.lateBeforeStart++;
+            return;
+        }
+        const uint64_t depth = state.highest - sequence;
+        if (depth >= kSequenceWindow)
+        {
+            // ビットマップの範囲外のため、重複か初回の受信か区別できない
+            stats.stale++;
+            return;
+        }
+        if (test(state, sequence))
+        {
+            stats.duplicates++;
+            return;
+        }
+        set(state, sequence);
+        stats.reordered++;
+        stats.missing--;
+        stats.maxReorderDepth = std::max(stats.maxReorderDepth, depth);
+    }
+
+    /**
+     * @brief トピックの追跡結果の変化分を合計に加算します
+     *
+     * @param before 更新前の追跡結果
+     * @param after 更新後の追跡結果
+     */
+    void accumulate(const SequenceStats &before, const SequenceStats &after)
+    {
+        m_total.received += after.received - before.received;
+        m_total.expected += after.expected - before.expected;
+        m_total.missing = m_total.missing + after.missing - before.missing;
+        m_total.gaps += after.gaps - before.gaps;
+        m_total.duplicates += after.duplicates - before.duplicates;
+        m_total.reordered += after.reordered - before.reordered;
+        m_total.restarts += after.restarts - before.restarts;
+        m_total.lateBeforeStart += after.lateBeforeStart - before.lateBeforeStart;
+        m_total.stale += after.stale - before.stale;
+        m_total.maxReorderDepth = std::max(m_total.maxReorderDepth, after.maxReorderDepth);
+    }
+
+private:
+    std::map<std::string, TopicState, std::less<>> m_topics; //! 未登録のトピックごとの追跡状態
+    std::vector<TopicState> m_topicsById;                    //! 登録済みのトピックのIDごとの追跡状態
+    SequenceStats m_total;                                   //! 全トピックの合計
+    LatencyHistogram m_transitDelay;                         //! 送信時刻から受信処理までの経過時間
+};
+
+#endif // SEQUENCE_TRACKER_HPP_
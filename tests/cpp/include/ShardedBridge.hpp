@@ -0,0 +1,201 @@
+/**
+ * @file ShardedBridge.hpp
+ * @brief SO_REUSEPORTで受信を複数スレッドに分散するMQTT中継の定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef SHARDED_BRIDGE_HPP_
+#define SHARDED_BRIDGE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "spdlog/spdlog.h"
+#include "MqttBridge.hpp"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @brief 同一の受信アドレスに複数のMqttBridgeをbindし、シャードごとのスレッドで受信するクラス
+ * @details 各シャードはSO_REUSEPORTを設定した専用の受信ソケットと送信ソケットを持ち、
+ * 専用のワーカースレッドで受信とハンドラ呼び出しを行う。カーネルは送信元アドレス・ポートの
+ * ハッシュでデータグラムを振り分けるため、同一送信元からのデータグラムは常に同じシャードで処理される。
+ * 送信元が複数ある場合に、受信処理をコア数に応じてスケールさせることを目的とする
+ */
+class ShardedBridge
+{
+public:
+    /**
+     * @brief 受信メッセージのハンドラ
+     * @details 引数はシャード番号、受信したシャードのMqttBridge、トピック、メッセージ本体。
+     * 各シャードのワーカースレッドから呼び出されるため、シャード間で共有する状態は呼び出し側で保護すること
+     */
+    using Handler = std::function<void(size_t, MqttBridge &, std::string_view, std::string_view)>;
+
+    /**
+     * @brief 新しいシャード分割MQTT中継を構成します
+     *
+     * @param recvIp 受信用IPアドレス
+     * @param recvPort 受信用ポート番号
+     * @param sendIp 送信用IPアドレス
+     * @param sendPort 送信用ポート
+     * @param shardCount シャード数(受信ソケット数およびワーカースレッド数)
+     * @param options 各シャードの構成オプション(reusePortは常に有効化される)
+     */
+    ShardedBridge(const std::string &recvIp, uint16_t recvPort,
+                  const std::string &sendIp, uint16_t sendPort,
+                  size_t shardCount, UdpOptions options = UdpOptions{})
+    {
+        if (shardCount == 0)
+        {
+            throw std::invalid_argument("shardCount must be positive");
+        }
+        options.reusePort = true;
+        m_shards.reserve(shardCount);
+        for (size_t i = 0; i < shardCount; ++i)
+        {
+            m_shards.push_back(std::make_unique<MqttBridge>(recvIp, recvPort, sendIp, sendPort, options));
+        }
+    }
+
+    /**
+     * @brief シャード分割MQTT中継を破棄します
+     * @details ワーカースレッドが動作中の場合は停止を待つ
+     */
+    ~ShardedBridge()
+    {
+        stop();
+    }
+
+    ShardedBridge(const ShardedBridge &) = delete;
+    ShardedBridge &operator=(const ShardedBridge &) = delete;
+
+    /**
+     * @brief シャードごとのワーカースレッドを起動します
+     *
+     * @param handler 受信メッセージのハンドラ
+     * @param pinThreads trueの場合、シャードiのスレッドをCPU(i % CPU数)に固定する(Linuxのみ)
+     * @param batchSize 1回の受信で取り出す最大データグラム数
+     */
+    void start(Handler handler, bool pinThreads = false, size_t batchSize = 32)
+    {
+        if (!m_workers.empty())
+        {
+            throw std::logic_error("ShardedBridge is already running");
+        }
+        m_handler = std::move(handler);
+        m_isRunning.store(true);
+        for (size_t i = 0; i < m_shards.size(); ++i)
+        {
+            m_workers.emplace_back([this, i, batchSize]()
+                                   { work(i, batchSize); });
+            if (pinThreads)
+            {
+                pinThread(m_workers.back(), i);
+            }
+        }
+    }
+
+    /**
+     * @brief ワーカースレッドを停止し、終了を待ちます
+     * @details 各スレッドは受信待機のタイムアウト(最大kPollTimeoutMs)以内に停止する
+     */
+    void stop()
+    {
+        m_isRunning.store(false);
+        for (auto &worker : m_workers)
+        {
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+        }
+        m_workers.clear();
+    }
+
+    /**
+     * @brief シャード数を返します
+     *
+     * @return size_t
+     */
+    size_t shardCount() const { return m_shards.size(); }
+
+    /**
+     * @brief i番目のシャードを返します
+     * @details 統計値はワーカースレッドが更新するため、stop()後に参照すること
+     * @param i シャード番号
+     * @return MqttBridge&
+     */
+    MqttBridge &shard(size_t i) { return *m_shards.at(i); }
+
+private:
+    /**
+     * @brief シャードごとのワーカースレッド処理
+     *
+     * @param index シャード番号
+     * @param batchSize 1回の受信で取り出す最大データグラム数
+     */
+    void work(size_t index, size_t batchSize)
+    {
+        MqttBridge &bridge = *m_shards[index];
+        while (m_isRunning.load(std::memory_order_relaxed))
+        {
+            for (const auto &[topic, message] : bridge.subscribeBatch(batchSize, kPollTimeoutMs))
+            {
+                try
+                {
+                    m_handler(index, bridge, topic, message);
+                }
+                catch (const std::exception &ex)
+                {
+                    spdlog::error("shard " + std::to_string(index) + " handler failed: " + ex.what());
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief スレッドをCPUに固定します
+     *
+     * @param worker 対象スレッド
+     * @param index シャード番号
+     */
+    static void pinThread(std::thread &worker, size_t index)
+    {
+#ifdef __linux__
+        const unsigned int cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        int err = pthread_setaffinity_np(worker.native_handle(), sizeof(set), &set);
+        if (err != 0)
+        {
+            spdlog::warn("pthread_setaffinity_np() failed: " + std::to_string(err));
+        }
+#else
+        (void)worker;
+        (void)index;
+#endif
+    }
+
+private:
+    static constexpr int kPollTimeoutMs = 100; //! 停止確認のための受信待機時間[msec]
+
+    std::vector<std::unique_ptr<MqttBridge>> m_shards; //! シャードごとのMQTT中継
+    std::vector<std::thread> m_workers;                //! シャードごとのワーカースレッド
+    std::atomic<bool> m_isRunning{false};              //! ワーカースレッドの動作フラグ
+    Handler m_handler;                                 //! 受信メッセージのハンドラ
+};
+
+#endif // SHARDED_BRIDGE_HPP_
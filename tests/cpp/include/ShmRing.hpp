@@ -0,0 +1,526 @@
+/**
+ * @file ShmRing.hpp
+ * @brief 同一ホスト内のプロセスへシステムコールなしでフレームを配送する共有メモリリングの定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている。
+ * 共有メモリにはファイルをmmap()した領域を使用するため、POSIX環境でのみ定義する
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef SHM_RING_HPP_
+#define SHM_RING_HPP_
+
+#ifndef _WIN32
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "spdlog/spdlog.h"
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * @brief 共有メモリリングの構成オプション
+ */
+struct ShmRingOptions
+{
+    uint32_t slotCount{1024};     //! スロット数(2のべき乗)。読み出し側がこれ以上遅れるとフレームを取りこぼす
+    uint32_t slotSize{64 * 1024}; //! フレーム1件あたりの最大バイト数
+};
+
+/**
+ * @brief 共有メモリリングへの書き込みの統計値
+ */
+struct ShmRingWriterStats
+{
+    uint64_t written{0};   //! 書き込んだフレーム数
+    uint64_t oversized{0}; //! slotSizeを超えたため書き込まなかったフレーム数
+    uint64_t wakeups{0};   //! 待機中の読み出し側を起こした回数
+};
+
+/**
+ * @brief 共有メモリリングからの読み出しの統計値
+ */
+struct ShmRingReaderStats
+{
+    uint64_t received{0}; //! 読み出したフレーム数
+    uint64_t lost{0};     //! 書き込み側に追い越されて読み出せなかったフレーム数
+    uint64_t waits{0};    //! フレームが無く待機した回数
+};
+
+namespace shmring
+{
+    constexpr uint64_t kMagic = 0x31474e4952534d55ull; //! ファイル識別子("UMSRING1")
+    constexpr uint32_t kVersion = 1;                   //! レイアウトのバージョン
+    constexpr size_t kCacheLine = 64;                  //! キャッシュラインサイズ[byte]
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory ring requires lock-free 64bit atomics");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared memory ring requires lock-free 32bit atomics");
+
+    /**
+     * @brief ファイル先頭のヘッダ
+     * @details 書き込み側と読み出し側で頻繁に更新する値は、偽共有を避けるため別のキャッシュラインに置く
+     */
+    struct Header
+    {
+        uint64_t magic;      //! ファイル識別子
+        uint32_t version;    //! レイアウトのバージョン
+        uint32_t slotCount;  //! スロット数
+        uint32_t slotSize;   //! フレーム1件あたりの最大バイト数
+        uint32_t slotStride; //! スロット1件あたりの領域サイズ[byte]
+        alignas(kCacheLine) std::atomic<uint64_t> writeSequence; //! 次に書き込むフレームの通し番号
+        alignas(kCacheLine) std::atomic<uint32_t> notify;        //! 起床通知用のfutexワード(最下位ビットは待機中の読み出し側の有無)
+    };
+
+    /**
+     * @brief スロットの先頭に置く管理情報
+     * @details sequenceはシーケンスロックとして使用する。通し番号nのフレームの書き込み中は2n+1、書き込み完了後は2n+2となる
+     */
+    struct SlotHeader
+    {
+        std::atomic<uint64_t> sequence; //! シーケンスロック
+        std::atomic<uint32_t> length;   //! フレームのバイト数
+    };
+
+    constexpr size_t kHeaderSize = (sizeof(Header) + kCacheLine - 1) / kCacheLine * kCacheLine;
+    constexpr size_t kSlotHeaderSize = (sizeof(SlotHeader) + kCacheLine - 1) / kCacheLine * kCacheLine;
+
+    /**
+     * @brief スロット1件あたりの領域サイズを返します
+     *
+     * @param slotSize フレーム1件あたりの最大バイト数
+     * @return size_t キャッシュライン境界に揃えたサイズ
+     */
+    inline size_t slotStride(size_t slotSize)
+    {
+        return kSlotHeaderSize + (slotSize + kCacheLine - 1) / kCacheLine * kCacheLine;
+    }
+
+    /**
+     * @brief futexワードの値が変わるまで待機します
+     * @details Linux以外では短時間スリープして戻る(呼び出し側で再確認すること)
+     * @param word futexワード
+     * @param expected 待機を開始する値
+     * @param timeoutMs タイムアウト時間[msec]
+     */
+    inline void futexWait(std::atomic<uint32_t> &word, uint32_t expected, int timeoutMs)
+    {
+#ifdef __linux__
+        // プロセス間で共有するため、FUTEX_PRIVATE_FLAGは付けない
+        timespec ts{timeoutMs / 1000, static_cast<long>(timeoutMs % 1000) * 1000000L};
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+#else
+        (void)word;
+        (void)expected;
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeoutMs, 1)));
+#endif
+    }
+
+    /**
+     * @brief futexワードで待機している全てのスレッドを起こします
+     *
+     * @param word futexワード
+     */
+    inline void futexWakeAll(std::atomic<uint32_t> &word)
+    {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+        (void)word;
+#endif
+    }
+} // namespace shmring
+
+/**
+ * @brief 共有メモリリングへフレームを書き込むクラス(書き込み側は1つのみ)
+ * @details 各スロットをシーケンスロックで保護するため、書き込みは読み出し側の進捗を待たず、
+ * 遅れた読み出し側は古いフレームを取りこぼす(読み出し側で検出して数える)。
+ * 書き込みはメモリコピーのみでシステムコールを呼ばず、待機中の読み出し側がいる場合のみfutexで起こす。
+ * ファイルは一時ファイルに初期化してから置き換えるため、前回のリングを読んでいる読み出し側が壊れたフレームを読むことはない。
+ * スレッドセーフではないため、書き込みは1つのスレッドから行うこと
+ */
+class ShmRingWriter
+{
+public:
+    /**
+     * @brief 共有メモリリングを作成します
+     * @details 同じパスに既存のファイルがある場合は置き換える
+     * @param path リングのファイルパス(/dev/shm配下にするとディスクへの書き戻しが発生しない)
+     * @param options 構成オプション
+     */
+    explicit ShmRingWriter(const std::string &path, const ShmRingOptions &options = ShmRingOptions{})
+        : m_options(options)
+    {
+        if (options.slotCount == 0 || (options.slotCount & (options.slotCount - 1)) != 0)
+        {
+            throw std::invalid_argument("slotCount must be a power of two");
+        }
+        if (options.slotSize == 0)
+        {
+            throw std::invalid_argument("slotSize must be positive");
+        }
+        m_stride = shmring::slotStride(options.slotSize);
+        m_size = shmring::kHeaderSize + m_stride * options.slotCount;
+
+        const std::string tempPath = path + ".tmp";
+        int fd = open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1)
+        {
+            throw std::runtime_error("open(" + tempPath + ") failed: " + std::to_string(errno));
+        }
+        if (ftruncate(fd, static_cast<off_t>(m_size)) == -1)
+        {
+            const int err = errno;
+            close(fd);
+            unlink(tempPath.c_str());
+            throw std::runtime_error("ftruncate(" + tempPath + ") failed: " + std::to_string(err));
+        }
+        void *base = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+            const int err = errno;
+            unlink(tempPath.c_str());
+            throw std::runtime_error("mmap(" + tempPath + ") failed: " + std::to_string(err));
+        }
+        m_base = static_cast<char *>(base);
+
+        // ftruncate()した領域はゼロで埋まっているため、ヘッダの値のみ設定する
+        auto *header = new (m_base) shmring::Header{};
+        header->version = shmring::kVersion;
+        header->slotCount = options.slotCount;
+        header->slotSize = options.slotSize;
+        header->slotStride = static_cast<uint32_t>(m_stride);
+        header->magic = shmring::kMagic;
+        for (uint32_t i = 0; i < options.slotCount; ++i)
+        {
+            new (m_base + shmring::kHeaderSize + m_stride * i) shmring::SlotHeader{};
+        }
+        m_header = header;
+
+        if (rename(tempPath.c_str(), path.c_str()) == -1)
+        {
+            const int err = errno;
+            munmap(m_base, m_size);
+            unlink(tempPath.c_str());
+            throw std::runtime_error("rename(" + path + ") failed: " + std::to_string(err));
+        }
+    }
+
+    /**
+     * @brief 共有メモリリングの書き込みを終了します
+     * @details ファイルは削除しない(読み出し側は書き込み済みのフレームを引き続き読める)
+     */
+    ~ShmRingWriter()
+    {
+        munmap(m_base, m_size);
+    }
+
+    ShmRingWriter(const ShmRingWriter &) = delete;
+    ShmRingWriter &operator=(const ShmRingWriter &) = delete;
+
+    /**
+     * @brief フレームを書き込みます
+     *
+     * @param frame 書き込むフレーム
+     * @return true 書き込み成功
+     * @return false slotSizeを超えたため書き込まなかった
+     */
+    bool write(std::string_view frame)
+    {
+        return writeGather(&frame, 1);
+    }
+
+    /**
+     * @brief 複数の領域を連結して1つのフレームとして書き込みます
+     *
+     * @param parts 書き込む領域の配列
+     * @param count 領域の数
+     * @return true 書き込み成功
+     * @return false slotSizeを超えたため書き込まなかった
+     */
+    bool writeGather(const std::string_view *parts, size_t count)
+    {
+        size_t length = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            length += parts[i].size();
+        }
+        if (length > m_options.slotSize)
+        {
+            if (m_stats.oversized++ == 0)
+            {
+                spdlog::warn("shared memory ring frame too large (" + std::to_string(length) + " bytes > slotSize " +
+                             std::to_string(m_options.slotSize) + " bytes)");
+            }
+            return false;
+        }
+
+        const uint64_t sequence = m_sequence;
+        char *slot = slotAt(sequence);
+        auto *slotHeader = reinterpret_cast<shmring::SlotHeader *>(slot);
+        slotHeader->sequence.store(2 * sequence + 1, std::memory_order_relaxed);
+        // 書き込み中の印を、本体の書き込みより先に読み出し側へ見せる
+        std::atomic_thread_fence(std::memory_order_release);
+        char *data = slot + shmring::kSlotHeaderSize;
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::memcpy(data, parts[i].data(), parts[i].size());
+            data += parts[i].size();
+        }
+        slotHeader->length.store(static_cast<uint32_t>(length), std::memory_order_relaxed);
+        slotHeader->sequence.store(2 * sequence + 2, std::memory_order_release);
+        m_sequence = sequence + 1;
+        m_header->writeSequence.store(m_sequence, std::memory_order_release);
+        m_stats.written++;
+
+        // 読み出し側の「待機中ビットを立ててから通し番号を確認する」処理と対になる。
+        // どちらかが必ず相手の更新を観測するため、起床通知を取りこぼさない
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_header->notify.load(std::memory_order_relaxed) & 1u)
+        {
+            // 待機中ビットを落とし、同時に通知回数を進める(起床した読み出し側が走り出すまでの間は再度起こさない)
+            m_header->notify.fetch_add(1, std::memory_order_release);
+            shmring::futexWakeAll(m_header->notify);
+            m_stats.wakeups++;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 統計値を返します
+     *
+     * @return const ShmRingWriterStats&
+     */
+    const ShmRingWriterStats &stats() const { return m_stats; }
+
+    /**
+     * @brief 構成オプションを返します
+     *
+     * @return const ShmRingOptions&
+     */
+    const ShmRingOptions &options() const { return m_options; }
+
+private:
+    char *slotAt(uint64_t sequence)
+    {
+        return m_base + shmring::kHeaderSize + m_stride * (sequence & (m_options.slotCount - 1));
+    }
+
+private:
+    ShmRingOptions m_options;
+    ShmRingWriterStats m_stats;
+    char *m_base{nullptr};                //! マップした領域の先頭
+    shmring::Header *m_header{nullptr};   //! リングのヘッダ
+    size_t m_size{0};                     //! マップした領域のサイズ[byte]
+    size_t m_stride{0};                   //! スロット1件あたりの領域サイズ[byte]
+    uint64_t m_sequence{0};               //! 次に書き込むフレームの通し番号
+};
+
+/**
+ * @brief 共有メモリリングからフレームを読み出すクラス
+ * @details 読み出し側はそれぞれ独立した読み出し位置を持つため、複数のプロセスが同じリングを読める。
+ * フレームは書き込み側に上書きされないよう内部バッファへコピーしてから整合性を確認するため、
+ * 読み出し途中で上書きされたフレーム(破損したフレーム)を返すことはない。
+ * フレームがある間はシステムコールを呼ばず、無い場合のみfutexで待機する。スレッドセーフではない
+ */
+class ShmRingReader
+{
+public:
+    /**
+     * @brief 共有メモリリングを開きます
+     * @details 開いた時点以降に書き込まれたフレームから読み出す
+     * @param path リングのファイルパス
+     * @param spinBudgetUs フレームが無い場合に、futexで待機する前にスピンして待つ最大時間[usec](0の場合はスピンしない)
+     */
+    explicit ShmRingReader(const std::string &path, int spinBudgetUs = 50)
+        : m_spinBudget(spinBudgetUs)
+    {
+        if (spinBudgetUs < 0)
+        {
+            throw std::invalid_argument("spinBudgetUs must not be negative");
+        }
+        int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd == -1)
+        {
+            throw std::runtime_error("open(" + path + ") failed: " + std::to_string(errno));
+        }
+        struct stat st;
+        if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < shmring::kHeaderSize)
+        {
+            close(fd);
+            throw std::runtime_error(path + " is not a shared memory ring");
+        }
+        m_size = static_cast<size_t>(st.st_size);
+        void *base = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+            throw std::runtime_error("mmap(" + path + ") failed: " + std::to_string(errno));
+        }
+        m_base = static_cast<char *>(base);
+        m_header = reinterpret_cast<shmring::Header *>(m_base);
+        if (m_header->magic != shmring::kMagic || m_header->version != shmring::kVersion ||
+            m_header->slotCount == 0 || (m_header->slotCount & (m_header->slotCount - 1)) != 0 ||
+            m_header->slotStride != shmring::slotStride(m_header->slotSize) ||
+            shmring::kHeaderSize + static_cast<size_t>(m_header->slotStride) * m_header->slotCount > m_size)
+        {
+            munmap(m_base, m_size);
+            throw std::runtime_error(path + " is not a compatible shared memory ring");
+        }
+        m_slotCount = m_header->slotCount;
+        m_stride = m_header->slotStride;
+        m_buffer.resize(m_header->slotSize);
+        m_sequence = m_header->writeSequence.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 共有メモリリングを閉じます
+     *
+     */
+    ~ShmRingReader()
+    {
+        munmap(m_base, m_size);
+    }
+
+    ShmRingReader(const ShmRingReader &) = delete;
+    ShmRingReader &operator=(const ShmRingReader &) = delete;
+
+    /**
+     * @brief 次のフレームを待機せずに読み出します
+     * @details 戻り値は内部バッファを参照し、次の読み出しを呼び出すまで有効
+     * @return std::optional<std::string_view> 読み出したフレーム(無い場合はstd::nullopt)
+     */
+    std::optional<std::string_view> tryReceive()
+    {
+        for (;;)
+        {
+            const uint64_t head = m_header->writeSequence.load(std::memory_order_acquire);
+            if (m_sequence == head)
+            {
+                return std::nullopt;
+            }
+            if (head - m_sequence > m_slotCount)
+            {
+                // 1周以上遅れた分は上書き済み
+                m_stats.lost += head - m_slotCount - m_sequence;
+                m_sequence = head - m_slotCount;
+            }
+
+            const char *slot = m_base + shmring::kHeaderSize + m_stride * (m_sequence & (m_slotCount - 1));
+            const auto *slotHeader = reinterpret_cast<const shmring::SlotHeader *>(slot);
+            const uint64_t expected = 2 * m_sequence + 2;
+            const uint64_t before = slotHeader->sequence.load(std::memory_order_acquire);
+            size_t length = 0;
+            if (before == expected)
+            {
+                length = std::min<size_t>(slotHeader->length.load(std::memory_order_relaxed), m_buffer.size());
+                std::memcpy(m_buffer.data(), slot + shmring::kSlotHeaderSize, length);
+                // コピーした本体より後にシーケンスロックを読み直す
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+            const uint64_t after = slotHeader->sequence.load(std::memory_order_relaxed);
+            m_sequence++;
+            if (before != expected || after != before)
+            {
+                // 読み出し中に書き込み側が1周して上書きした
+                m_stats.lost++;
+                continue;
+            }
+            m_stats.received++;
+            return std::string_view(m_buffer.data(), length);
+        }
+    }
+
+    /**
+     * @brief 次のフレームを読み出します
+     * @details フレームが無い場合は、spinBudgetUsだけスピンして待ち、それでも無ければ
+     * 書き込まれるかタイムアウトするまでfutexで待機する。戻り値は内部バッファを参照し、次の読み出しを呼び出すまで有効
+     * @param timeoutMs タイムアウト時間[msec](0の場合は待機しない)
+     * @return std::optional<std::string_view> 読み出したフレーム(タイムアウト時はstd::nullopt)
+     */
+    std::optional<std::string_view> receiveView(int timeoutMs = 100)
+    {
+        using namespace std::chrono;
+        const auto start = steady_clock::now();
+        const auto deadline = start + milliseconds(timeoutMs);
+        const auto spinUntil = std::min(deadline, start + m_spinBudget);
+        for (;;)
+        {
+            if (auto frame = tryReceive())
+            {
+                return frame;
+            }
+            // 連続して届くフレームの間隔が短い場合は、futexによる起床(システムコール)を避ける
+            if (steady_clock::now() < spinUntil)
+            {
+                continue;
+            }
+            const auto remaining = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+            if (remaining <= 0)
+            {
+                return std::nullopt;
+            }
+            uint32_t notify = m_header->notify.load(std::memory_order_relaxed);
+            while (!(notify & 1u) && !m_header->notify.compare_exchange_weak(notify, notify | 1u, std::memory_order_seq_cst))
+            {
+            }
+            if (m_header->writeSequence.load(std::memory_order_seq_cst) == m_sequence)
+            {
+                m_stats.waits++;
+                shmring::futexWait(m_header->notify, notify | 1u, static_cast<int>(remaining));
+            }
+        }
+    }
+
+    /**
+     * @brief 未読のフレーム数を返します
+     * @details 1周以上遅れている場合は、取りこぼすフレームを含む
+     * @return uint64_t
+     */
+    uint64_t pending() const
+    {
+        return m_header->writeSequence.load(std::memory_order_acquire) - m_sequence;
+    }
+
+    /**
+     * @brief 統計値を返します
+     *
+     * @return const ShmRingReaderStats&
+     */
+    const ShmRingReaderStats &stats() const { return m_stats; }
+
+private:
+    ShmRingReaderStats m_stats;
+    std::chrono::microseconds m_spinBudget; //! futexで待機する前にスピンする最大時間
+    char *m_base{nullptr};              //! マップした領域の先頭
+    shmring::Header *m_header{nullptr}; //! リングのヘッダ
+    size_t m_size{0};                   //! マップした領域のサイズ[byte]
+    size_t m_stride{0};                 //! スロット1件あたりの領域サイズ[byte]
+    uint32_t m_slotCount{0};            //! スロット数
+    uint64_t m_sequence{0};             //! 次に読み出すフレームの通し番号
+    std::vector<char> m_buffer;         //! 読み出したフレームのコピー
+};
+
+#endif // _WIN32
+
+#endif // SHM_RING_HPP_
@@ -0,0 +1,127 @@
+/**
+ * @file TokenBucket.hpp
+ * @brief 送信レートを制限するトークンバケットの定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef TOKEN_BUCKET_HPP_
+#define TOKEN_BUCKET_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+
+/**
+ * @brief バイト数とパケット数の2つのレートで送信時刻を割り当てるトークンバケット
+ * @details reserve()は送信するデータグラムの出発時刻(その時刻まで待てば両方のレートを満たす時刻)を返す。
+ * 残量が不足した分は負の残量として次の割り当てに持ち越すため、まとめて予約した
+ * データグラムの出発時刻はレートに従って等間隔に並ぶ。スレッドセーフではない
+ */
+class TokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 制限しないトークンバケットを構成します
+     *
+     */
+    TokenBucket() = default;
+
+    /**
+     * @brief 新しいトークンバケットを構成します
+     *
+     * @param bytesPerSec 送信バイト数の上限[byte/s](0の場合は制限しない)
+     * @param packetsPerSec 送信データグラム数の上限[個/s](0の場合は制限しない)
+     * @param burstBytes 連続して送信できる最大バイト数
+     * @param burstPackets 連続して送信できる最大データグラム数
+     */
+    TokenBucket(double bytesPerSec, double packetsPerSec, double burstBytes, double burstPackets)
+        : m_bytesPerSec(bytesPerSec), m_packetsPerSec(packetsPerSec),
+          m_burstBytes(burstBytes), m_burstPackets(burstPackets),
+          m_bytes(burstBytes), m_packets(burstPackets), m_last(Clock::now())
+    {
+        if (bytesPerSec < 0 || packetsPerSec < 0)
+        {
+            throw std::invalid_argument("pacing rates must not be negative");
+        }
+        if (burstBytes <= 0 || burstPackets <= 0)
+        {
+            throw std::invalid_argument("pacing bursts must be positive");
+        }
+    }
+
+    /**
+     * @brief レートを制限しているかを返します
+     *
+     * @return bool
+     */
+    bool enabled() const { return m_bytesPerSec > 0 || m_packetsPerSec > 0; }
+
+    /**
+     * @brief データグラムの送信枠を予約し、出発時刻を返します
+     *
+     * @param bytes 送信するバイト数
+     * @param packets 送信するデータグラム数(GSOでまとめて送信する場合は分割後の数)
+     * @param now 現在時刻
+     * @return Clock::time_point 出発時刻(now以前の場合は直ちに送信してよい)
+     */
+    Clock::time_point reserve(size_t bytes, size_t packets = 1, Clock::time_point now = Clock::now())
+    {
+        if (now > m_last)
+        {
+            const double elapsed = std::chrono::duration<double>(now - m_last).count();
+            m_bytes = std::min(m_burstBytes, m_bytes + elapsed * m_bytesPerSec);
+            m_packets = std::min(m_burstPackets, m_packets + elapsed * m_packetsPerSec);
+            m_last = now;
+        }
+        m_bytes -= static_cast<double>(bytes);
+        m_packets -= static_cast<double>(packets);
+        double wait = 0;
+        if (m_bytesPerSec > 0 && m_bytes < 0)
+        {
+            wait = std::max(wait, -m_bytes / m_bytesPerSec);
+        }
+        if (m_packetsPerSec > 0 && m_packets < 0)
+        {
+            wait = std::max(wait, -m_packets / m_packetsPerSec);
+        }
+        return now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(wait));
+    }
+
+    /**
+     * @brief 指定時刻まで待機します
+     * @details スリープの誤差(数十usec)を避けるため、残りがkSpinThreshold未満になったらスピンして待つ
+     * @param deadline 待機を終える時刻
+     */
+    static void waitUntil(Clock::time_point deadline)
+    {
+        if (deadline - Clock::now() > kSpinThreshold)
+        {
+            std::this_thread::sleep_until(deadline - kSpinThreshold);
+        }
+        while (Clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    static constexpr std::chrono::microseconds kSpinThreshold{100}; //! スリープせずにスピンで待つ残り時間
+
+    double m_bytesPerSec{0};   //! 送信バイト数の上限[byte/s]
+    double m_packetsPerSec{0}; //! 送信データグラム数の上限[個/s]
+    double m_burstBytes{1};    //! バイト数の残量の上限
+    double m_burstPackets{1};  //! データグラム数の残量の上限
+    double m_bytes{1};         //! バイト数の残量(負の場合は前借り分)
+    double m_packets{1};       //! データグラム数の残量(負の場合は前借り分)
+    Clock::time_point m_last;  //! 最後に残量を補充した時刻
+};
+
+#endif // TOKEN_BUCKET_HPP_
@@ -0,0 +1,179 @@
+/**
+ * @file TopicRegistry.hpp
+ * @brief トピック文字列を連番の整数IDに対応付ける登録表の定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef TOPIC_REGISTRY_HPP_
+#define TOPIC_REGISTRY_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief 登録したトピックのID(0から登録順に割り当てる)
+ */
+using TopicId = uint32_t;
+
+/**
+ * @brief 登録されていないトピックを示すID
+ */
+constexpr TopicId kInvalidTopicId = std::numeric_limits<TopicId>::max();
+
+/**
+ * @brief トピック文字列を連番の整数IDに対応付けるクラス
+ * @details 登録時にのみ文字列を複製してメモリを確保する。検索はオープンアドレス法(線形探索)のハッシュ表で行い、
+ * 登録済みのトピックの検索ではメモリ確保は発生しない。IDは連番のため、トピックごとの状態を配列の添字で参照できる。
+ * 登録したトピックは削除しない。スレッドセーフではない
+ */
+class TopicRegistry
+{
+public:
+    /**
+     * @brief 空の登録表を構成します
+     *
+     */
+    TopicRegistry() : m_slots(kInitialCapacity, kEmpty) {}
+
+    /**
+     * @brief トピックを登録し、IDを返します
+     * @details 登録済みの場合は既存のIDを返す
+     * @param topic トピック
+     * @return TopicId
+     */
+    TopicId intern(std::string_view topic)
+    {
+        const uint64_t hash = hashOf(topic);
+        size_t slot = probe(topic, hash);
+        if (m_slots[slot] != kEmpty)
+        {
+            return m_slots[slot];
+        }
+        if (m_names.size() >= kInvalidTopicId)
+        {
+            throw std::length_error("too many topics");
+        }
+        const TopicId id = static_cast<TopicId>(m_names.size());
+        m_names.emplace_back(topic);
+        m_hashes.push_back(hash);
+        // 使用率を1/2以下に保ち、探索の長さを抑える
+        if (m_names.size() * 2 > m_slots.size())
+        {
+            rehash(m_slots.size() * 2);
+            slot = probe(topic, hash);
+        }
+        m_slots[slot] = id;
+        return id;
+    }
+
+    /**
+     * @brief 登録済みのトピックのIDを返します(登録はしない)
+     *
+     * @param topic トピック
+     * @return TopicId 未登録の場合はkInvalidTopicId
+     */
+    TopicId find(std::string_view topic) const
+    {
+        return m_slots[probe(topic, hashOf(topic))];
+    }
+
+    /**
+     * @brief IDに対応するトピックを返します
+     * @details 戻り値は登録表が存在する間有効
+     * @param id トピックのID
+     * @return std::string_view
+     */
+    std::string_view name(TopicId id) const
+    {
+        if (id >= m_names.size())
+        {
+            throw std::out_of_range("unknown topic id " + std::to_string(id));
+        }
+        return m_names[id];
+    }
+
+    /**
+     * @brief 登録済みのトピック数を返します(IDは0～size()-1)
+     *
+     * @return size_t
+     */
+    size_t size() const { return m_names.size(); }
+
+private:
+    static constexpr size_t kInitialCapacity = 64;   //! ハッシュ表の初期の枠数(2のべき乗)
+    static constexpr TopicId kEmpty = kInvalidTopicId; //! 空き枠を示す値
+
+    /**
+     * @brief トピックのハッシュ値(FNV-1a)を求めます
+     *
+     * @param topic トピック
+     * @return uint64_t
+     */
+    static uint64_t hashOf(std::string_view topic)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : topic)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief トピックが格納されている枠、または格納すべき空き枠の位置を返します
+     *
+     * @param topic トピック
+     * @param hash トピックのハッシュ値
+     * @return size_t
+     */
+    size_t probe(std::string_view topic, uint64_t hash) const
+    {
+        const size_t mask = m_slots.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+        {
+            const TopicId id = m_slots[slot];
+            // ハッシュ値が一致した場合のみ文字列を比較する
+            if (id == kEmpty || (m_hashes[id] == hash && m_names[id] == topic))
+            {
+                return slot;
+            }
+        }
+    }
+
+    /**
+     * @brief ハッシュ表の枠数を変更し、登録済みのトピックを格納し直します
+     *
+     * @param capacity 新しい枠数(2のべき乗)
+     */
+    void rehash(size_t capacity)
+    {
+        m_slots.assign(capacity, kEmpty);
+        const size_t mask = capacity - 1;
+        // 登録中の最後のトピックは呼び出し元で格納する
+        for (TopicId id = 0; id + 1 < m_names.size(); ++id)
+        {
+            size_t slot = m_hashes[id] & mask;
+            while (m_slots[slot] != kEmpty)
+            {
+                slot = (slot + 1) & mask;
+            }
+            m_slots[slot] = id;
+        }
+    }
+
+private:
+    std::vector<TopicId> m_slots;   //! ハッシュ表(各枠はトピックのID、空き枠はkEmpty)
+    std::deque<std::string> m_names; //! IDごとのトピック(要素のアドレスは変わらない)
+    std::vector<uint64_t> m_hashes; //! IDごとのトピックのハッシュ値
+};
+
+#endif // TOPIC_REGISTRY_HPP_
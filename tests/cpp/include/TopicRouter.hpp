@@ -0,0 +1,359 @@
+/**
+ * @file TopicRouter.hpp
+ * @brief トピックフィルタ(MQTTのワイルドカード+、#を含む)ごとにハンドラを呼び分ける振り分け表の定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef TOPIC_ROUTER_HPP_
+#define TOPIC_ROUTER_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "TopicRegistry.hpp"
+
+/**
+ * @brief トピックの振り分けの統計値
+ */
+struct TopicRouterStats
+{
+    uint64_t dispatched{0}; //! 振り分けたメッセージ数
+    uint64_t matched{0};    //! 1つ以上のハンドラに一致したメッセージ数
+    uint64_t unmatched{0};  //! どのハンドラにも一致しなかったメッセージ数
+    uint64_t calls{0};      //! ハンドラの呼び出し回数
+};
+
+/**
+ * @brief トピックフィルタをトピックの階層ごとの木(トライ)に登録し、受信したトピックに一致するハンドラを呼び出すクラス
+ * @details フィルタの書式はMQTTに従う。階層は'/'で区切り、'+'は任意の1階層、'#'(末尾のみ)は0個以上の残りの階層に一致する。
+ * '$'で始まるトピックは、先頭の階層のワイルドカードには一致しない。
+ * 振り分けの計算量はトピックの階層数に比例し(各階層で完全一致の子を1回検索する)、登録済みのフィルタ数には依存しない。
+ * トピックのID(TopicRegistry)を指定して振り分けた場合は、IDごとに一致したハンドラを記憶し、
+ * 次回からは木をたどらずに呼び出す(登録・解除を行うと記憶を破棄する)。
+ * 振り分け時のメモリ確保は、一致したハンドラ数がそれまでの最大を超えた場合と、IDごとの初回の振り分け時のみ発生する。
+ * スレッドセーフではない。ハンドラの中で登録・解除を行わないこと
+ */
+class TopicRouter
+{
+public:
+    /**
+     * @brief 受信メッセージのハンドラ
+     * @details 引数はトピック、メッセージ本体。いずれも受信バッファを参照するため、呼び出し中のみ有効
+     */
+    using Handler = std::function<void(std::string_view, std::string_view)>;
+
+    /**
+     * @brief 登録したハンドラの識別番号
+     */
+    using HandlerId = size_t;
+
+    /**
+     * @brief トピックフィルタにハンドラを登録します
+     * @details 同じフィルタに複数のハンドラを登録した場合、および複数のフィルタが一致した場合は、登録順に全て呼び出す
+     * @param filter トピックフィルタ(例: "realtime/command"、"sensor/+/temperature"、"ingest/#")
+     * @param handler ハンドラ
+     * @return HandlerId 解除に使う識別番号
+     */
+    HandlerId add(std::string_view filter, Handler handler)
+    {
+        validate(filter);
+        if (!handler)
+        {
+            throw std::invalid_argument("handler must not be empty");
+        }
+        Node *node = &m_root;
+        bool isMultiLevel = false;
+        forEachLevel(filter, [&](std::string_view level)
+                     {
+            if (level == "#")
+            {
+                isMultiLevel = true;
+                return;
+            }
+            std::unique_ptr<Node> *child = nullptr;
+            if (level == "+")
+            {
+                child = &node->single;
+            }
+            else
+            {
+                auto it = node->children.find(level);
+                if (it == node->children.end())
+                {
+                    it = node->children.emplace(std::string(level), nullptr).first;
+                }
+                child = &it->second;
+            }
+            if (!*child)
+            {
+                *child = std::make_unique<Node>();
+            }
+            node = child->get(); });
+
+        const HandlerId id = m_entries.size();
+        m_entries.push_back(Entry{std::string(filter), std::move(handler)});
+        (isMultiLevel ? node->multi : node->exact).push_back(id);
+        m_handlerCount++;
+        m_generation++;
+        return id;
+    }
+
+    /**
+     * @brief 登録したハンドラを解除します
+     *
+     * @param id add()が返した識別番号
+     * @return true 解除した
+     * @return false 登録されていない(解除済みを含む)
+     */
+    bool remove(HandlerId id)
+    {
+        if (id >= m_entries.size() || !m_entries[id].handler)
+        {
+            return false;
+        }
+        const std::string filter = m_entries[id].filter;
+        Node *node = &m_root;
+        bool isMultiLevel = false;
+        forEachLevel(filter, [&](std::string_view level)
+                     {
+            if (level == "#")
+            {
+                isMultiLevel = true;
+                return;
+            }
+            node = level == "+" ? node->single.get() : node->children.find(level)->second.get(); });
+        auto &ids = isMultiLevel ? node->multi : node->exact;
+        ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+        m_entries[id].handler = nullptr;
+        m_entries[id].filter.clear();
+        m_handlerCount--;
+        m_generation++;
+        return true;
+    }
+
+    /**
+     * @brief トピックに一致する全てのハンドラを呼び出します
+     *
+     * @param topic 受信したトピック
+     * @param message 受信したメッセージ本体
+     * @return size_t 呼び出したハンドラ数
+     */
+    size_t dispatch(std::string_view topic, std::string_view message)
+    {
+        match(topic, m_matched);
+        return invoke(m_matched, topic, message);
+    }
+
+    /**
+     * @brief トピックのIDを指定して、一致する全てのハンドラを呼び出します
+     * @details IDごとに一致したハンドラを記憶するため、2回目以降は木をたどらない。
+     * IDは常に同じTopicRegistryから取得したものを使うこと
+     * @param id トピックのID(kInvalidTopicIdの場合はdispatch(topic, message)と同じ)
+     * @param topic 受信したトピック(IDに対応するもの)
+     * @param message 受信したメッセージ本体
+     * @return size_t 呼び出したハンドラ数
+     */
+    size_t dispatch(TopicId id, std::string_view topic, std::string_view message)
+    {
+        if (id == kInvalidTopicId)
+        {
+            return dispatch(topic, message);
+        }
+        if (id >= m_routes.size())
+        {
+            m_routes.resize(id + 1);
+        }
+        Route &route = m_routes[id];
+        if (route.generation != m_generation)
+        {
+            match(topic, route.handlers);
+            route.generation = m_generation;
+        }
+        return invoke(route.handlers, topic, message);
+    }
+
+    /**
+     * @brief 登録されているハンドラ数を返します
+     *
+     * @return size_t
+     */
+    size_t size() const { return m_handlerCount; }
+
+    /**
+     * @brief 振り分けの統計値を返します
+     *
+     * @return const TopicRouterStats&
+     */
+    const TopicRouterStats &stats() const { return m_stats; }
+
+private:
+    /**
+     * @brief トピックの1階層に対応する木の節
+     */
+    struct Node
+    {
+        std::map<std::string, std::unique_ptr<Node>, std::less<>> children; //! 完全一致する階層の子
+        std::unique_ptr<Node> single;   //! '+'の子
+        std::vector<HandlerId> exact;   //! この節で終わるフィルタのハンドラ
+        std::vector<HandlerId> multi;   //! この節の後に'#'が続くフィルタのハンドラ
+    };
+
+    /**
+     * @brief トピックのIDごとに記憶した、一致するハンドラ
+     */
+    struct Route
+    {
+        uint64_t generation{0};          //! 記憶した時点の登録状態(m_generationと異なる場合は無効)
+        std::vector<HandlerId> handlers; //! 一致するハンドラ(登録順)
+    };
+
+    /**
+     * @brief 登録したハンドラ
+     */
+    struct Entry
+    {
+        std::string filter; //! トピックフィルタ(解除済みの場合は空)
+        Handler handler;    //! ハンドラ(解除済みの場合は空)
+    };
+
+    /**
+     * @brief トピック(フィルタ)の各階層を先頭から順に処理します
+     *
+     * @param topic トピック(フィルタ)
+     * @param func 各階層を受け取る関数
+     */
+    template <class Func>
+    static void forEachLevel(std::string_view topic, Func &&func)
+    {
+        size_t pos = 0;
+        while (true)
+        {
+            const size_t end = std::min(topic.find('/', pos), topic.size());
+            func(topic.substr(pos, end - pos));
+            if (end == topic.size())
+            {
+                return;
+            }
+            pos = end + 1;
+        }
+    }
+
+    /**
+     * @brief トピックフィルタの書式を検証します
+     * @details ワイルドカードは階層全体を占める必要があり、'#'は最後の階層のみに置ける
+     * @param filter トピックフィルタ
+     */
+    static void validate(std::string_view filter)
+    {
+        if (filter.empty())
+        {
+            throw std::invalid_argument("topic filter must not be empty");
+        }
+        bool isAfterMultiLevel = false;
+        forEachLevel(filter, [&](std::string_view level)
+                     {
+            if (isAfterMultiLevel)
+            {
+                throw std::invalid_argument("'#' must be the last level of topic filter: " + std::string(filter));
+            }
+            if (level.size() > 1 && level.find_first_of("+#") != std::string_view::npos)
+            {
+                throw std::invalid_argument("wildcard must occupy an entire level: " + std::string(filter));
+            }
+            isAfterMultiLevel = level == "#"; });
+    }
+
+    /**
+     * @brief トピックに一致するハンドラを登録順に集めます
+     *
+     * @param topic トピック
+     * @param matched 一致したハンドラの格納先
+     */
+    void match(std::string_view topic, std::vector<HandlerId> &matched)
+    {
+        matched.clear();
+        collect(m_root, topic, 0, matched);
+        // 複数のフィルタが一致した場合も登録順に呼び出す
+        std::sort(matched.begin(), matched.end());
+    }
+
+    /**
+     * @brief ハンドラを順に呼び出し、統計値を更新します
+     *
+     * @param handlers 呼び出すハンドラ
+     * @param topic トピック
+     * @param message メッセージ本体
+     * @return size_t 呼び出したハンドラ数
+     */
+    size_t invoke(const std::vector<HandlerId> &handlers, std::string_view topic, std::string_view message)
+    {
+        m_stats.dispatched++;
+        if (handlers.empty())
+        {
+            m_stats.unmatched++;
+            return 0;
+        }
+        m_stats.matched++;
+        for (HandlerId id : handlers)
+        {
+            m_entries[id].handler(topic, message);
+        }
+        m_stats.calls += handlers.size();
+        return handlers.size();
+    }
+
+    /**
+     * @brief トピックのpos以降の階層に一致するハンドラを集めます
+     *
+     * @param node 直前の階層までが一致した節
+     * @param topic 受信したトピック
+     * @param pos 次に照合する階層の先頭位置(topic.size()を超えた場合は全階層が一致済み)
+     * @param matched 一致したハンドラの格納先
+     */
+    static void collect(const Node &node, std::string_view topic, size_t pos, std::vector<HandlerId> &matched)
+    {
+        // '$'で始まるトピック(システムトピック)は先頭の階層のワイルドカードに一致させない
+        const bool isWildcardAllowed = pos != 0 || topic.empty() || topic.front() != '$';
+        if (isWildcardAllowed)
+        {
+            matched.insert(matched.end(), node.multi.begin(), node.multi.end());
+        }
+        if (pos > topic.size())
+        {
+            matched.insert(matched.end(), node.exact.begin(), node.exact.end());
+            return;
+        }
+        const size_t end = std::min(topic.find('/', pos), topic.size());
+        const std::string_view level = topic.substr(pos, end - pos);
+        auto it = node.children.find(level);
+        if (it != node.children.end())
+        {
+            collect(*it->second, topic, end + 1, matched);
+        }
+        if (node.single && isWildcardAllowed)
+        {
+            collect(*node.single, topic, end + 1, matched);
+        }
+    }
+
+private:
+    Node m_root;                     //! 木の根(トピックの先頭の階層の親)
+    std::vector<Entry> m_entries;    //! 登録したハンドラ(添字が識別番号)
+    std::vector<HandlerId> m_matched; //! dispatch()で一致したハンドラ(再利用して確保を避ける)
+    std::vector<Route> m_routes;      //! トピックのIDごとに記憶した、一致するハンドラ
+    uint64_t m_generation{1};        //! 登録状態(登録・解除のたびに増やす)
+    size_t m_handlerCount{0};        //! 登録されているハンドラ数
+    TopicRouterStats m_stats;        //! 振り分けの統計値
+};
+
+#endif // TOPIC_ROUTER_HPP_
@@ -11,52 +11,141 @@
 #ifndef UDP_HANDLER_HPP_
 #define UDP_HANDLER_HPP_
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <initializer_list>
 #include <iostream>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
 #include <cstring>
+#include <memory>
+#include <stdexcept>
 #include "spdlog/spdlog.h"
-#ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
-using socket_t = SOCKET;
-#define CLOSE_SOCKET(s) closesocket(s)
-#define GET_ERROR() WSAGetLastError()
-#define INVALID_SOCK INVALID_SOCKET
-#define SOCK_ERR SOCKET_ERROR
-#else
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-#include <errno.h>
-using socket_t = int;
-#define CLOSE_SOCKET(s) close(s)
-#define GET_ERROR() errno
-#define INVALID_SOCK (-1)
-#define SOCK_ERR (-1)
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#ifndef SOL_UDP
+#define SOL_UDP IPPROTO_UDP
+#endif
+#ifndef SO_TXTIME
+#define SO_TXTIME 61
+#define SCM_TXTIME SO_TXTIME
 #endif
+#endif
+#include "DatagramTransport.hpp"
+#include "IoUring.hpp"
+#include "LatencyHistogram.hpp"
+#include "TokenBucket.hpp"
+#include "ProducerSockets.hpp"
+
+/**
+ * @brief UdpHandlerの入出力方式
+ */
+enum class IoBackend
+{
+    Socket,  //! poll()/recvmmsg()/sendmmsg()などの通常のソケットAPI
+    IoUring, //! io_uring(Linuxのみ。利用できない場合はSocketへフォールバックする)
+};
+
+/**
+ * @brief UdpHandlerの構成オプション
+ */
+struct UdpOptions
+{
+    size_t recvBufferSize{kMaxDatagramSize}; //! データグラム1件あたりの受信バッファサイズ[byte](最大kMaxDatagramSize)
+    int socketRecvBuffer{0};                 //! 受信ソケットのSO_RCVBUF[byte](0の場合はOS既定値)
+    int socketSendBuffer{0};                 //! 送信ソケットのSO_SNDBUF[byte](0の場合はOS既定値)
+    bool reusePort{false};                   //! 受信ソケットにSO_REUSEPORTを設定し、同一アドレスへの複数bindを許可する
+    bool reuseAddress{false};                //! 受信ソケットにSO_REUSEADDRを設定する(受信アドレスがマルチキャストの場合は常に設定)
+    std::string multicastInterface;          //! マルチキャストの参加・送信に使うインターフェースのIPv4アドレス(空の場合はOSの既定)
+    int multicastTtl{1};                     //! マルチキャスト送信のTTL(1の場合は同一セグメント内のみに届く)
+    bool multicastLoopback{true};            //! 送信したマルチキャストを同一ホストの受信者にも配送するか
+    IoBackend backend{IoBackend::Socket};    //! 入出力方式
+    unsigned ioUringEntries{64};             //! io_uringの投入キューのエントリ数
+    size_t ioUringBuffers{64};               //! io_uringに登録する受信バッファ数
+    bool udpGro{false};                      //! 受信ソケットでUDP_GROを有効化し、結合されたデータグラムを分割して返す(Linuxのみ)
+    size_t zeroCopyThreshold{0};             //! sendZeroCopy()でMSG_ZEROCOPYを使う最小サイズ[byte](0の場合は無効。Linuxのみ)
+    bool rxTimestamping{false};              //! カーネルの受信時刻(SO_TIMESTAMPNS)を取得する(Linuxのみ)
+    bool txTimestamping{false};              //! カーネルの送信時刻(SO_TIMESTAMPING)を取得する(Linuxのみ。takeTxTimestamps()で定期的に回収すること)
+    int busyPollUs{0};                       //! 受信ソケットに設定するSO_BUSY_POLLの時間[usec](0の場合は設定しない。Linuxのみ)
+    int spinBudgetUs{0};                     //! 受信待機の前に非ブロッキングで受信を確認し続ける時間[usec](0の場合は無効)
+    double pacingBytesPerSec{0};             //! 送信バイト数の上限[byte/s](0の場合は制限しない。trySend()は対象外)
+    double pacingPacketsPerSec{0};           //! 送信データグラム数の上限[個/s](0の場合は制限しない。trySend()は対象外)
+    size_t pacingBurstBytes{1500};           //! ペーシング時に間隔を空けずに送信できる最大バイト数
+    size_t pacingBurstPackets{1};            //! ペーシング時に間隔を空けずに送信できる最大データグラム数
+    bool pacingTxTime{false};                //! 送信を待機せず、SO_TXTIMEで出発時刻をカーネルに渡す(Linuxのみ。送信経路にfq qdiscが必要)
+};
+
+/**
+ * @brief カーネルが記録した送信時刻
+ * @details idは送信ソケットで送信したデータグラムの通し番号(0始まり、送信呼び出し1回ごとに1増える)
+ */
+struct TxTimestamp
+{
+    uint32_t id{0};       //! 送信の通し番号
+    KernelTimestamp time; //! データグラムがドライバに渡された時刻
+};
+
+/**
+ * @brief UdpHandlerの送受信統計
+ */
+struct UdpStats
+{
+    uint64_t received{0};   //! 受信したデータグラム数(切り詰めにより破棄したものを含む)
+    uint64_t truncated{0};  //! 受信バッファに収まらず破棄したデータグラム数
+    uint64_t dropped{0};    //! 受信キューが溢れてカーネルが破棄したデータグラム数(Linuxのみ)
+    uint64_t sent{0};       //! 送信したデータグラム数
+    uint64_t sendErrors{0}; //! 送信に失敗したデータグラム数
+    uint64_t groCoalesced{0};      //! GROにより結合されて届いた受信単位の数
+    uint64_t zeroCopySent{0};      //! MSG_ZEROCOPYで送信要求した回数
+    uint64_t zeroCopyCompleted{0}; //! MSG_ZEROCOPYの完了通知を受けた回数
+    uint64_t zeroCopyCopied{0};    //! MSG_ZEROCOPYを要求したがカーネルがコピーした回数
+    uint64_t spinHits{0};          //! スピン中にデータグラムの到着を検知した回数
+    uint64_t spinMisses{0};        //! スピン予算内に到着せず、ブロッキング待機に移行した回数
+    uint64_t spinIterations{0};    //! スピン中に受信を確認した回数(システムコール数)
+    uint64_t spinNanoseconds{0};   //! スピンに費やした時間の合計[nsec](おおよそのCPU消費時間)
+    uint64_t pacedSends{0};        //! ペーシングにより送信を遅らせた回数
+    uint64_t pacingWaitNanoseconds{0}; //! ペーシングで送信を待機した時間の合計[nsec]
+    uint64_t ioUringErrors{0};         //! io_uringのrecvmsgが失敗し、再投入した回数
+};
 
 /**
  * @brief UDP通信を行うための基本処理を提供するクラス
  *
  */
-class UdpHandler
+class UdpHandler : public DatagramTransport
 {
 public:
+    using DatagramTransport::sendGather;
+
     /**
      * @brief 新しいUDP処理オブジェクトを構成します
      *
-     * @param recvIp 受信用IPアドレス
+     * @param recvIp 受信用IPアドレス(マルチキャストアドレスの場合はグループに参加する)
      * @param recvPort 受信用ポート番号
-     * @param sendIp 送信用IPアドレス
+     * @param sendIp 送信用IPアドレス(マルチキャストアドレスの場合は1回の送信でグループの全受信者に届く)
      * @param sendPort 送信用ポート
+     * @param options 構成オプション
      */
     UdpHandler(const std::string &recvIp, uint16_t recvPort,
-               const std::string &sendIp, uint16_t sendPort)
+               const std::string &sendIp, uint16_t sendPort,
+               const UdpOptions &options = UdpOptions{})
+        : m_options(options), m_pool(options.recvBufferSize)
     {
+        if (options.recvBufferSize == 0 || options.recvBufferSize > kMaxDatagramSize)
+        {
+            throw std::invalid_argument("recvBufferSize must be in 1.." + std::to_string(kMaxDatagramSize));
+        }
+        if (options.spinBudgetUs < 0 || options.busyPollUs < 0)
+        {
+            throw std::invalid_argument("spinBudgetUs and busyPollUs must not be negative");
+        }
+        m_pacer = TokenBucket(options.pacingBytesPerSec, options.pacingPacketsPerSec,
+                              static_cast<double>(options.pacingBurstBytes), static_cast<double>(options.pacingBurstPackets));
         // 受信ソケット初期化
         m_recvSock = socket(AF_INET, SOCK_DGRAM, 0);
         if (m_recvSock == INVALID_SOCK)
@@ -77,11 +166,50 @@ public:
         }
 #endif
         m_recvAddr.sin_port = htons(recvPort);
-        if (bind(m_recvSock, (sockaddr *)&m_recvAddr, sizeof(m_recvAddr)) == SOCK_ERR)
+        if (options.reusePort)
+        {
+#ifdef SO_REUSEPORT
+            if (!setSocketOption(m_recvSock, SOL_SOCKET, SO_REUSEPORT, 1, "SO_REUSEPORT"))
+            {
+                CLOSE_SOCKET(m_recvSock);
+                throw std::runtime_error("SO_REUSEPORT failed: " + std::to_string(GET_ERROR()));
+            }
+#else
+            CLOSE_SOCKET(m_recvSock);
+            throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+        }
+        const bool multicastRecv = isMulticastAddress(m_recvAddr.sin_addr);
+        if (options.reuseAddress || multicastRecv)
+        {
+            // 同一ホストの複数の受信者が同じグループ・ポートを受信できるようにする
+            setSocketOption(m_recvSock, SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+        }
+#ifdef IP_MULTICAST_ALL
+        if (multicastRecv)
+        {
+            // 同一ホストの他のソケットが参加したグループのデータグラムを受信しない
+            setSocketOption(m_recvSock, IPPROTO_IP, IP_MULTICAST_ALL, 0, "IP_MULTICAST_ALL");
+        }
+#endif
+        sockaddr_in bindAddr = m_recvAddr;
+#ifdef _WIN32
+        if (multicastRecv)
+        {
+            // Windowsではマルチキャストアドレスにbindできないため、全インターフェースで受信する
+            bindAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+        }
+#endif
+        if (bind(m_recvSock, (sockaddr *)&bindAddr, sizeof(bindAddr)) == SOCK_ERR)
         {
             CLOSE_SOCKET(m_recvSock);
             throw std::runtime_error("bind() failed: " + std::to_string(GET_ERROR()));
         }
+        if (multicastRecv && !joinGroup(recvIp, options.multicastInterface))
+        {
+            CLOSE_SOCKET(m_recvSock);
+            throw std::runtime_error("failed to join multicast group " + recvIp);
+        }
 
         // 送信ソケット初期化
         m_sendSock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -104,6 +232,20 @@ public:
         }
 #endif
         m_sendAddr.sin_port = htons(sendPort);
+        if (isMulticastAddress(m_sendAddr.sin_addr))
+        {
+            applyMulticastSendOptions(m_sendSock);
+        }
+
+        applySocketOptions();
+        if (options.backend == IoBackend::IoUring)
+        {
+            setupIoUring();
+            if (options.spinBudgetUs > 0 && backend() == IoBackend::IoUring)
+            {
+                spdlog::warn("spinBudgetUs is ignored by the io_uring backend");
+            }
+        }
     }
 
     /**
@@ -112,49 +254,220 @@ public:
      */
     ~UdpHandler()
     {
+#ifdef UDP_HANDLER_HAS_IO_URING
+        // リングがソケットを参照しているため先に破棄する
+        m_uringReceiver.reset();
+        m_uringSender.reset();
+#endif
         CLOSE_SOCKET(m_recvSock);
         CLOSE_SOCKET(m_sendSock);
     }
 
     /**
-     * @brief データ受信処理
-     * @details UDPデータを受信した場合は、受信したデータを返す。もし受信していない場合は、std::nulloptを返す
+     * @brief データ受信処理(コピーなし)
+     * @details 受信したデータは内部のバッファプールに格納し、その領域を参照するビューを返す。
+     * 戻り値は次の受信処理を呼び出すまで有効
      * @param timeoutMs タイムアウト時間[msec]
-     * @return std::optional<std::string>
+     * @return std::optional<std::string_view> 受信したデータ(未受信の場合はstd::nullopt)
      */
-    std::optional<std::string> receive(int timeoutMs = 100)
+    std::optional<std::string_view> receiveView(int timeoutMs = 100) override
     {
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(m_recvSock, &readfds);
-
-        // timeoutMs を秒／マイクロ秒に分割
-        timeval tv;
-        tv.tv_sec = timeoutMs / 1000;
-        tv.tv_usec = (timeoutMs % 1000) * 1000;
-
-        int nfds = static_cast<int>(m_recvSock + 1);
-        int sel = select(nfds, &readfds, nullptr, nullptr, &tv);
-        if (sel == SOCK_ERR)
+        if (m_pendingIndex < m_pending.size())
+        {
+            // GROで結合されて届いた残りのセグメントを返す
+            return m_pending[m_pendingIndex++];
+        }
+#ifdef UDP_HANDLER_HAS_IO_URING
+        if (m_uringReceiver)
+        {
+            const auto &batch = receiveBatch(1, timeoutMs);
+            if (batch.empty() || batch[0].empty())
+            {
+                return std::nullopt;
+            }
+            m_pending.assign(batch.begin() + 1, batch.end());
+            m_pendingIndex = 0;
+            return batch[0];
+        }
+#endif
+        if (!waitReadable(timeoutMs))
         {
-            spdlog::error("select() failed: " + std::to_string(GET_ERROR()));
             return std::nullopt;
         }
-        if (sel > 0 && FD_ISSET(m_recvSock, &readfds))
+        m_pool.reserve(1);
+        char *buf = m_pool.slot(0);
+#ifdef _WIN32
+        int len = recvfrom(m_recvSock, buf, static_cast<int>(m_pool.slotSize()), 0, nullptr, nullptr);
+        if (len == SOCK_ERR)
         {
-            char buf[1024];
-            int len = recvfrom(m_recvSock, buf, sizeof(buf) - 1, 0, nullptr, nullptr);
-            if (len > 0)
+            if (GET_ERROR() == WSAEMSGSIZE)
             {
-                buf[len] = '\0';
-                return std::string(buf, len);
+                m_stats.received++;
+                countTruncated(m_pool.slotSize());
             }
             else
             {
                 spdlog::warn("recvfrom() failed: " + std::to_string(GET_ERROR()));
             }
+            return std::nullopt;
+        }
+        m_stats.received++;
+#else
+        m_controlPool.reserve(1);
+        iovec iov{buf, m_pool.slotSize()};
+        msghdr hdr{};
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = m_controlPool.slot(0);
+        hdr.msg_controllen = m_controlPool.slotSize();
+        auto len = recvmsg(m_recvSock, &hdr, MSG_TRUNC);
+        if (len == SOCK_ERR)
+        {
+            spdlog::warn("recvmsg() failed: " + std::to_string(GET_ERROR()));
+            return std::nullopt;
+        }
+        if (!acceptDatagram(hdr, static_cast<size_t>(len)))
+        {
+            return std::nullopt;
+        }
+        if (m_lastSegmentSize > 0)
+        {
+            m_pending.clear();
+            m_pendingIndex = 1;
+            appendSegments(m_pending, buf, static_cast<size_t>(len));
+            return m_pending[0];
+        }
+#endif
+        if (len == 0)
+        {
+            return std::nullopt;
+        }
+        return std::string_view(buf, static_cast<size_t>(len));
+    }
+
+    /**
+     * @brief データ一括受信処理
+     * @details 受信可能になるまで最大timeoutMs待機した後、受信キューに溜まっているデータグラムを
+     * 最大maxCount件まとめて取り出す。Linuxではrecvmmsg()により1回のシステムコールで取り出す。
+     * EventReactorなどで受信可能を検知済みの場合は、timeoutMsに0を指定すると待機処理を省略できる。
+     * UDP_GROを有効にした場合、結合されて届いたデータグラムは分割して返すため、maxCountを超えることがある。
+     * 戻り値は内部バッファを参照するため、次の受信処理を呼び出すまで有効
+     * @param maxCount 1回で取り出す最大データグラム数
+     * @param timeoutMs タイムアウト時間[msec]
+     * @return const ReceiveBatch& 受信したデータグラム群(未受信の場合は空)
+     */
+    const ReceiveBatch &receiveBatch(size_t maxCount = 16, int timeoutMs = 100) override
+    {
+        m_batch.m_views.clear();
+        m_batch.m_timestamps.clear();
+        if (maxCount == 0)
+        {
+            return m_batch;
+        }
+        if (m_pendingIndex < m_pending.size())
+        {
+            // receiveView()で返しきれていないGROのセグメントを先に返す
+            while (m_batch.m_views.size() < maxCount && m_pendingIndex < m_pending.size())
+            {
+                m_batch.m_views.push_back(m_pending[m_pendingIndex++]);
+                m_batch.m_timestamps.push_back(m_lastTimestamp);
+            }
+            return m_batch;
+        }
+#ifdef UDP_HANDLER_HAS_IO_URING
+        if (m_uringReceiver)
+        {
+            return receiveBatchIoUring(maxCount, timeoutMs);
+        }
+#endif
+#ifdef __linux__
+        // タイムアウト0の場合は待機せず、recvmmsg()のノンブロッキング受信のみ行う
+        if (timeoutMs != 0 && !waitReadable(timeoutMs))
+#else
+        if (!waitReadable(timeoutMs))
+#endif
+        {
+            return m_batch;
+        }
+        reserveBatch(maxCount);
+#ifdef __linux__
+        for (size_t i = 0; i < maxCount; ++i)
+        {
+            m_batchIovecs[i].iov_base = m_pool.slot(i);
+            m_batchIovecs[i].iov_len = m_pool.slotSize();
+            std::memset(&m_batchMsgs[i], 0, sizeof(mmsghdr));
+            m_batchMsgs[i].msg_hdr.msg_iov = &m_batchIovecs[i];
+            m_batchMsgs[i].msg_hdr.msg_iovlen = 1;
+            m_batchMsgs[i].msg_hdr.msg_control = m_controlPool.slot(i);
+            m_batchMsgs[i].msg_hdr.msg_controllen = m_controlPool.slotSize();
+        }
+        int count = recvmmsg(m_recvSock, m_batchMsgs.data(), static_cast<unsigned int>(maxCount), MSG_DONTWAIT | MSG_TRUNC, nullptr);
+        if (count == SOCK_ERR)
+        {
+            if (GET_ERROR() != EAGAIN && GET_ERROR() != EWOULDBLOCK)
+            {
+                spdlog::warn("recvmmsg() failed: " + std::to_string(GET_ERROR()));
+            }
+            return m_batch;
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            if (acceptDatagram(m_batchMsgs[i].msg_hdr, m_batchMsgs[i].msg_len))
+            {
+                appendSegments(m_batch.m_views, m_pool.slot(i), m_batchMsgs[i].msg_len);
+                m_batch.m_timestamps.resize(m_batch.m_views.size(), m_lastTimestamp);
+            }
         }
-        return std::nullopt;
+#elif defined(_WIN32)
+        // recvmmsg()が無い環境では、受信可能な間recvfrom()を繰り返す
+        do
+        {
+            char *slot = m_pool.slot(m_batch.m_views.size());
+            int len = recvfrom(m_recvSock, slot, static_cast<int>(m_pool.slotSize()), 0, nullptr, nullptr);
+            if (len == SOCK_ERR)
+            {
+                if (GET_ERROR() != WSAEMSGSIZE)
+                {
+                    spdlog::warn("recvfrom() failed: " + std::to_string(GET_ERROR()));
+                    break;
+                }
+                m_stats.received++;
+                countTruncated(m_pool.slotSize());
+                continue;
+            }
+            m_stats.received++;
+            m_batch.m_views.emplace_back(slot, len);
+        } while (m_batch.m_views.size() < maxCount && waitReadable(0));
+#else
+        // recvmmsg()が無いPOSIX環境では、受信可能な間recvmsg()を繰り返す
+        // (切り詰めはerrnoではなくmsg_flagsのMSG_TRUNCで通知される)
+        do
+        {
+            const size_t index = m_batch.m_views.size();
+            char *slot = m_pool.slot(index);
+            iovec iov{slot, m_pool.slotSize()};
+            msghdr hdr{};
+            hdr.msg_iov = &iov;
+            hdr.msg_iovlen = 1;
+            hdr.msg_control = m_controlPool.slot(index);
+            hdr.msg_controllen = m_controlPool.slotSize();
+            auto len = recvmsg(m_recvSock, &hdr, 0);
+            if (len == SOCK_ERR)
+            {
+                if (GET_ERROR() != EAGAIN && GET_ERROR() != EWOULDBLOCK)
+                {
+                    spdlog::warn("recvmsg() failed: " + std::to_string(GET_ERROR()));
+                }
+                break;
+            }
+            if (acceptDatagram(hdr, static_cast<size_t>(len)))
+            {
+                appendSegments(m_batch.m_views, slot, static_cast<size_t>(len));
+                m_batch.m_timestamps.resize(m_batch.m_views.size(), m_lastTimestamp);
+            }
+        } while (m_batch.m_views.size() < maxCount && waitReadable(0));
+#endif
+        return m_batch;
     }
 
     /**
@@ -162,8 +475,14 @@ public:
      *
      * @param msg
      */
-    void send(const std::string &msg)
+    void send(const std::string &msg) override
     {
+        if (m_pacer.enabled())
+        {
+            const std::string_view part(msg);
+            sendGather(&part, 1);
+            return;
+        }
         int sent = sendto(
             m_sendSock,
             msg.c_str(),
@@ -173,33 +492,1355 @@ public:
             sizeof(m_sendAddr));
         if (sent == SOCK_ERR)
         {
+            m_stats.sendErrors++;
             spdlog::warn("sendto() failed: " + std::to_string(GET_ERROR()));
+            return;
         }
+        m_stats.sent++;
     }
-    static bool startupSock()
+
+    /**
+     * @brief 待機せずにメッセージを送信
+     * @details 送信バッファが満杯の場合は待機せずにEAGAINを返す(Windowsでは通常の送信となる)。
+     * 非同期送信の実装に使用する
+     * @param msg 送信するデータグラム
+     * @return int 0:送信成功、それ以外:エラーコード
+     */
+    int trySend(std::string_view msg) override
     {
 #ifdef _WIN32
+        const int flags = 0;
+#else
+        const int flags = MSG_DONTWAIT;
+#endif
+        int sent = static_cast<int>(sendto(
+            m_sendSock,
+            msg.data(),
+            static_cast<int>(msg.size()),
+            flags,
+            reinterpret_cast<const sockaddr *>(&m_sendAddr),
+            sizeof(m_sendAddr)));
+        if (sent == SOCK_ERR)
+        {
+            const int err = GET_ERROR();
+            if (err != EAGAIN && err != EWOULDBLOCK)
+            {
+                m_stats.sendErrors++;
+            }
+            return err;
+        }
+        m_stats.sent++;
+        return 0;
+    }
 
-        WSADATA wsa;
-        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+    /**
+     * @brief 複数の領域を連結して1つのデータグラムとして送信
+     * @details 各領域はsendmsg()のI/Oベクタとして渡すため、連結のためのコピーは発生しない。
+     * ペーシングが有効な場合は、出発時刻まで待機してから送信する(SO_TXTIMEでは待機しない)
+     * @param parts 送信する領域の配列
+     * @param count 領域の数(kMaxGatherParts以下)
+     * @return true 送信成功
+     * @return false 送信失敗
+     */
+    bool sendGather(const std::string_view *parts, size_t count) override
+    {
+        if (count > kMaxGatherParts)
         {
-            spdlog::error("WSAStartup failed");
+            throw std::invalid_argument("sendGather() supports up to " + std::to_string(kMaxGatherParts) + " parts");
+        }
+        size_t totalBytes = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            totalBytes += parts[i].size();
+        }
+        const uint64_t txTime = pace(totalBytes);
+#ifdef _WIN32
+        (void)txTime;
+        WSABUF bufs[kMaxGatherParts];
+        for (size_t i = 0; i < count; ++i)
+        {
+            bufs[i].buf = const_cast<CHAR *>(parts[i].data());
+            bufs[i].len = static_cast<ULONG>(parts[i].size());
+        }
+        DWORD sentBytes = 0;
+        int sent = WSASendTo(
+            m_sendSock,
+            bufs,
+            static_cast<DWORD>(count),
+            &sentBytes,
+            0,
+            reinterpret_cast<const sockaddr *>(&m_sendAddr),
+            sizeof(m_sendAddr),
+            nullptr,
+            nullptr);
+        if (sent == SOCK_ERR)
+        {
+            m_stats.sendErrors++;
+            spdlog::warn("WSASendTo() failed: " + std::to_string(GET_ERROR()));
+            return false;
+        }
+#else
+        iovec iov[kMaxGatherParts];
+        for (size_t i = 0; i < count; ++i)
+        {
+            iov[i].iov_base = const_cast<char *>(parts[i].data());
+            iov[i].iov_len = parts[i].size();
+        }
+        msghdr msg{};
+        msg.msg_name = &m_sendAddr;
+        msg.msg_namelen = sizeof(m_sendAddr);
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+#ifdef __linux__
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint64_t))];
+        if (txTime != 0)
+        {
+            std::memset(control, 0, sizeof(control));
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            msg.msg_controllen = addTxTime(CMSG_FIRSTHDR(&msg), txTime);
+        }
+#else
+        // SO_TXTIMEが無い環境では、pace()が出発時刻まで待機する(txTimeは常に0)
+        (void)txTime;
+#endif
+        if (sendmsg(m_sendSock, &msg, 0) == SOCK_ERR)
+        {
+            m_stats.sendErrors++;
+            spdlog::warn("sendmsg() failed: " + std::to_string(GET_ERROR()));
             return false;
         }
 #endif
+        m_stats.sent++;
         return true;
     }
-    static void cleanupSock()
+
+    /**
+     * @brief 複数の領域を連結して1つのデータグラムとして送信(複数スレッドから同時に呼び出し可能)
+     * @details 呼び出し元スレッドごとに送信先へconnect()したソケットを使う(初回の呼び出し時に開く)。
+     * 接続済みソケットは送信ごとの経路検索を省略できる。ペーシング、SO_TXTIME、送信時刻の取得は行わず、
+     * 結果はstats()ではなくproducerStats()に集計する
+     * @param parts 送信する領域の配列
+     * @param count 領域の数(ProducerSockets::kMaxGatherParts以下)
+     * @return true 送信成功
+     * @return false 送信失敗
+     */
+    bool sendConcurrent(const std::string_view *parts, size_t count) override
     {
-#ifdef _WIN32
-        WSACleanup();
+        return m_producers.send(parts, count) == 0;
+    }
+
+    /**
+     * @brief sendConcurrent()の送信統計を返します
+     *
+     * @return ProducerStats
+     */
+    ProducerStats producerStats() const { return m_producers.stats(); }
+
+    /**
+     * @brief 複数のデータグラムを一括送信
+     * @details Linuxではsendmmsg()により1回のシステムコールで送信する。
+     * io_uringバックエンドでは、sendmsgを投入キューにまとめて投入する。
+     * ペーシングが有効な場合は、出発時刻を迎えたデータグラムごとにまとめて送信する
+     * (io_uringは使用しない。SO_TXTIMEでは各データグラムに出発時刻を付けて一度に渡す)。
+     * 失敗したデータグラムは個別にログ出力せず、batchの各要素と戻り値で報告する
+     * @param batch 送信するデータグラム群(各要素に送信結果が格納される)
+     * @return SendBatchResult 送信結果の概要
+     */
+    SendBatchResult sendBatch(SendBatch &batch) override
+    {
+        SendBatchResult result;
+        auto &entries = batch.m_entries;
+        for (auto &entry : entries)
+        {
+            entry.sent = false;
+            entry.sentBytes = 0;
+            entry.error = 0;
+        }
+#ifdef __linux__
+        const size_t count = entries.size();
+        if (m_sendMsgs.size() < count)
+        {
+            m_sendMsgs.resize(count);
+            m_sendIovecs.resize(count);
+        }
+        if (m_pacer.enabled())
+        {
+            m_departures.resize(count);
+            m_sendControl.assign(m_txTimeEnabled ? count * kTxTimeControlSize : 0, 0);
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto &entry = entries[i];
+            m_sendIovecs[i].iov_base = const_cast<char *>(entry.payload.data());
+            m_sendIovecs[i].iov_len = entry.payload.size();
+            std::memset(&m_sendMsgs[i], 0, sizeof(mmsghdr));
+            m_sendMsgs[i].msg_hdr.msg_name = entry.dest ? &entry.dest.value() : &m_sendAddr;
+            m_sendMsgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            m_sendMsgs[i].msg_hdr.msg_iov = &m_sendIovecs[i];
+            m_sendMsgs[i].msg_hdr.msg_iovlen = 1;
+            if (m_pacer.enabled())
+            {
+                m_departures[i] = m_pacer.reserve(entry.payload.size());
+                if (m_txTimeEnabled)
+                {
+                    auto &hdr = m_sendMsgs[i].msg_hdr;
+                    hdr.msg_control = m_sendControl.data() + i * kTxTimeControlSize;
+                    hdr.msg_controllen = kTxTimeControlSize;
+                    addTxTime(CMSG_FIRSTHDR(&hdr), toTxTime(m_departures[i]));
+                }
+            }
+        }
+        const bool softwarePacing = m_pacer.enabled() && !m_txTimeEnabled;
+#ifdef UDP_HANDLER_HAS_IO_URING
+        if (m_uringSender && !softwarePacing)
+        {
+            m_sendErrors.resize(count);
+            m_uringSender->send(m_sendMsgs.data(), count, m_sendErrors.data());
+            for (size_t i = 0; i < count; ++i)
+            {
+                entries[i].error = m_sendErrors[i];
+                entries[i].sent = m_sendErrors[i] == 0;
+                entries[i].sentBytes = entries[i].sent ? m_sendMsgs[i].msg_len : 0;
+            }
+        }
+        size_t offset = m_uringSender && !softwarePacing ? count : 0;
+#else
+        size_t offset = 0;
 #endif
-    };
+        while (offset < count)
+        {
+            // ソフトウェアによるペーシングでは、先頭の出発時刻まで待ってから出発時刻を迎えた分をまとめて送信する
+            size_t end = count;
+            if (softwarePacing)
+            {
+                waitForDeparture(m_departures[offset]);
+                const auto now = TokenBucket::Clock::now();
+                for (end = offset + 1; end < count && m_departures[end] <= now; ++end)
+                {
+                }
+            }
+            int sent = sendmmsg(m_sendSock, m_sendMsgs.data() + offset, static_cast<unsigned int>(end - offset), 0);
+            if (sent == SOCK_ERR)
+            {
+                int err = GET_ERROR();
+                if (err == EINTR)
+                {
+                    continue;
+                }
+                if (err == EAGAIN || err == EWOULDBLOCK)
+                {
+                    // 送信バッファが満杯の場合は残りを未送信として返す
+                    for (; offset < count; ++offset)
+                    {
+                        entries[offset].error = err;
+                    }
+                    break;
+                }
+                // 先頭のデータグラムのみ失敗として残りの送信を継続
+                entries[offset++].error = err;
+                continue;
+            }
+            for (int i = 0; i < sent; ++i, ++offset)
+            {
+                entries[offset].sent = true;
+                entries[offset].sentBytes = m_sendMsgs[offset].msg_len;
+            }
+        }
+#else
+        for (auto &entry : entries)
+        {
+            pace(entry.payload.size());
+            const sockaddr_in &dest = entry.dest ? entry.dest.value() : m_sendAddr;
+            int sent = sendto(
+                m_sendSock,
+                entry.payload.data(),
+                static_cast<int>(entry.payload.size()),
+                0,
+                reinterpret_cast<const sockaddr *>(&dest),
+                sizeof(dest));
+            if (sent == SOCK_ERR)
+            {
+                entry.error = GET_ERROR();
+            }
+            else
+            {
+                entry.sent = true;
+                entry.sentBytes = static_cast<size_t>(sent);
+            }
+        }
+#endif
+        for (const auto &entry : entries)
+        {
+            if (entry.sent)
+            {
+                result.sentCount++;
+                m_stats.sent++;
+            }
+            else
+            {
+                result.failedCount++;
+                m_stats.sendErrors++;
+                if (result.firstError == 0)
+                {
+                    result.firstError = entry.error;
+                }
+            }
+        }
+        return result;
+    }
 
-private:
-    socket_t m_recvSock{INVALID_SOCK};
-    socket_t m_sendSock{INVALID_SOCK};
-    sockaddr_in m_recvAddr{};
-    sockaddr_in m_sendAddr{};
+    /**
+     * @brief 連続した領域を固定長のセグメントに分割して送信
+     * @details LinuxではUDP_SEGMENT(GSO)を指定し、最大kMaxGsoSegments個のセグメントを1回のsendmsg()で
+     * 送信してカーネル(またはNIC)で分割させる。GSOが利用できない場合はsendBatch()で個別に送信する。
+     * 受信側から見ると、segmentSizeごとに区切られた個別のデータグラムとなる
+     * @param buffer 送信する領域
+     * @param segmentSize セグメント長[byte](最後のセグメントのみ短くなる場合がある)
+     * @return size_t 送信できたセグメント数
+     */
+    size_t sendSegmented(std::string_view buffer, uint16_t segmentSize)
+    {
+        if (segmentSize == 0)
+        {
+            throw std::invalid_argument("segmentSize must be positive");
+        }
+        size_t sentSegments = 0;
+        size_t offset = 0;
+#ifdef __linux__
+        const size_t chunkSize = gsoChunkSize(segmentSize);
+        while (m_gsoSupported && offset < buffer.size())
+        {
+            const size_t chunk = std::min(chunkSize, buffer.size() - offset);
+            const size_t segments = (chunk + segmentSize - 1) / segmentSize;
+            if (sendSegment(buffer.data() + offset, chunk, segmentSize, 0, pace(chunk, segments)))
+            {
+                sentSegments += segments;
+                m_stats.sent += segments;
+            }
+            else if (isGsoUnsupported(GET_ERROR()))
+            {
+                // 残りは個別送信に切り替える
+                spdlog::warn("UDP_SEGMENT is not available, falling back to per-datagram send: " + std::to_string(GET_ERROR()));
+                m_gsoSupported = false;
+                break;
+            }
+            else
+            {
+                m_stats.sendErrors += segments;
+                spdlog::warn("sendmsg(UDP_SEGMENT) failed: " + std::to_string(GET_ERROR()));
+            }
+            offset += chunk;
+        }
+#endif
+        if (offset < buffer.size())
+        {
+            m_segmentBatch.clear();
+            for (; offset < buffer.size(); offset += segmentSize)
+            {
+                m_segmentBatch.add(buffer.substr(offset, segmentSize));
+            }
+            sentSegments += sendBatch(m_segmentBatch).sentCount;
+        }
+        return sentSegments;
+    }
+
+    /**
+     * @brief 送信完了までバッファを保持し、MSG_ZEROCOPYで送信
+     * @details UdpOptions::zeroCopyThreshold以上のサイズの場合、カーネルへのコピーを省略するMSG_ZEROCOPYで送信する。
+     * カーネルは送信完了までbufferの内容を直接参照するため、完了通知を受けるまでbufferを保持する。
+     * 完了通知は送信ソケットのエラーキューに届き、本関数の呼び出し時またはreapZeroCopy()で回収する。
+     * 閾値未満、または非対応の環境では通常の送信を行う。segmentSizeを指定した場合はGSOと併用する
+     * @param buffer 送信するデータ(送信完了まで参照を保持する)
+     * @param segmentSize セグメント長[byte](0の場合は1つのデータグラムとして送信)
+     * @return true 送信成功
+     * @return false 送信失敗
+     */
+    bool sendZeroCopy(std::shared_ptr<const std::string> buffer, uint16_t segmentSize = 0)
+    {
+        if (!buffer)
+        {
+            throw std::invalid_argument("buffer must not be null");
+        }
+#ifdef __linux__
+        if (m_zeroCopyEnabled && buffer->size() >= m_options.zeroCopyThreshold &&
+            (segmentSize == 0 || m_gsoSupported))
+        {
+            reapZeroCopy();
+            const size_t chunkSize = segmentSize == 0 ? buffer->size() : gsoChunkSize(segmentSize);
+            bool success = true;
+            for (size_t offset = 0; offset < buffer->size() || offset == 0; offset += chunkSize)
+            {
+                const size_t chunk = std::min(chunkSize, buffer->size() - offset);
+                const size_t segments = segmentSize == 0 ? 1 : (chunk + segmentSize - 1) / segmentSize;
+                const uint64_t txTime = pace(chunk, segments);
+                if (sendSegment(buffer->data() + offset, chunk, segmentSize, MSG_ZEROCOPY, txTime))
+                {
+                    // 送信に成功した呼び出しごとに連番で完了通知される
+                    m_zeroCopyInFlight.emplace_back(m_zeroCopyNextId++, buffer);
+                    m_stats.zeroCopySent++;
+                    m_stats.sent += segments;
+                }
+                else if (GET_ERROR() == ENOBUFS && sendSegment(buffer->data() + offset, chunk, segmentSize, 0, txTime))
+                {
+                    // ピン留め可能なメモリの上限に達した場合は通常送信で代替する
+                    m_stats.sent += segments;
+                }
+                else
+                {
+                    m_stats.sendErrors += segments;
+                    spdlog::warn("sendmsg(MSG_ZEROCOPY) failed: " + std::to_string(GET_ERROR()));
+                    success = false;
+                }
+                if (chunk == 0)
+                {
+                    break;
+                }
+            }
+            return success;
+        }
+#endif
+        if (segmentSize > 0)
+        {
+            return sendSegmented(*buffer, segmentSize) == (buffer->size() + segmentSize - 1) / segmentSize;
+        }
+        return sendGather({std::string_view(*buffer)});
+    }
+
+    /**
+     * @brief MSG_ZEROCOPYの完了通知を回収し、送信が完了したバッファを解放します
+     * @details 待機はしない。EventReactorの周期処理などから定期的に呼び出すこと
+     * @return size_t 今回完了した送信の数
+     */
+    size_t reapZeroCopy()
+    {
+#ifdef __linux__
+        if (m_zeroCopyInFlight.empty())
+        {
+            return 0;
+        }
+        const uint64_t before = m_stats.zeroCopyCompleted;
+        drainErrorQueue();
+        return static_cast<size_t>(m_stats.zeroCopyCompleted - before);
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * @brief カーネルが記録した送信時刻を取り出します
+     * @details UdpOptions::txTimestampingが有効な場合に、送信ソケットのエラーキューに届いた送信時刻を回収して
+     * outに追加する。未回収の送信時刻は最新のkMaxTxTimestamps件まで保持する。待機はしない。
+     * 回収しない間は送信ごとにエラーキューへ通知が溜まるため、送信時刻が不要な場合はtxTimestampingを有効にしないこと
+     * @param out 送信時刻の出力先
+     * @return size_t 追加した件数
+     */
+    size_t takeTxTimestamps(std::vector<TxTimestamp> &out)
+    {
+#ifdef __linux__
+        drainErrorQueue();
+#endif
+        const size_t count = m_txTimestamps.size();
+        out.insert(out.end(), m_txTimestamps.begin(), m_txTimestamps.end());
+        m_txTimestamps.clear();
+        return count;
+    }
+
+    /**
+     * @brief 直前にreceiveView()またはreceive()で返したデータグラムをカーネルが受信した時刻を返します
+     * @details UdpOptions::rxTimestampingが無効な場合は既定値を返す。receiveBatch()の場合はReceiveBatch::timestamp()を使用すること
+     * @return KernelTimestamp
+     */
+    KernelTimestamp lastTimestamp() const { return m_lastTimestamp; }
+
+    /**
+     * @brief カーネルの受信から受信処理で取り出すまでの待ち時間の分布を返します
+     * @details UdpOptions::rxTimestampingが有効な場合に、受信したデータグラムごとに記録される
+     * @return const LatencyHistogram&
+     */
+    const LatencyHistogram &receiveDelay() const { return m_receiveDelay; }
+
+    /**
+     * @brief 完了通知を待っているMSG_ZEROCOPY送信の数を返します
+     *
+     * @return size_t
+     */
+    size_t zeroCopyInFlight() const { return m_zeroCopyInFlight.size(); }
+
+    /**
+     * @brief 受信ソケットをマルチキャストグループに参加させます
+     * @details 受信アドレスにマルチキャストアドレスを指定した場合は、構成時に自動で参加する。
+     * 1つの受信ソケットで複数のグループを受信する場合に使用する(受信ポートは共通)
+     * @param group グループのIPv4アドレス
+     * @param interfaceIp 参加に使うインターフェースのIPv4アドレス(空の場合はOSの既定)
+     * @return true 参加成功
+     * @return false 参加失敗
+     */
+    bool joinGroup(const std::string &group, const std::string &interfaceIp = "")
+    {
+        return changeMembership(IP_ADD_MEMBERSHIP, group, interfaceIp, "IP_ADD_MEMBERSHIP");
+    }
+
+    /**
+     * @brief 受信ソケットをマルチキャストグループから離脱させます
+     *
+     * @param group グループのIPv4アドレス
+     * @param interfaceIp 参加時に指定したインターフェースのIPv4アドレス
+     * @return true 離脱成功
+     * @return false 離脱失敗
+     */
+    bool leaveGroup(const std::string &group, const std::string &interfaceIp = "")
+    {
+        return changeMembership(IP_DROP_MEMBERSHIP, group, interfaceIp, "IP_DROP_MEMBERSHIP");
+    }
+
+    /**
+     * @brief IPアドレスとポート番号から送信先アドレスを生成します
+     *
+     * @param ip IPアドレス
+     * @param port ポート番号
+     * @return sockaddr_in
+     */
+    static sockaddr_in makeAddress(const std::string &ip, uint16_t port)
+    {
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+#ifdef _WIN32
+        if (InetPton(AF_INET, ip.c_str(), &addr.sin_addr) != 1)
+        {
+            throw std::runtime_error("InetPton(" + ip + ") failed: " + std::to_string(GET_ERROR()));
+        }
+#else
+        if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1)
+        {
+            throw std::runtime_error("inet_pton(" + ip + ") failed: " + std::to_string(GET_ERROR()));
+        }
+#endif
+        addr.sin_port = htons(port);
+        return addr;
+    }
+
+    /**
+     * @brief 受信ソケットを返します
+     * @details EventReactorなどへ受信ソケットを登録するために使用する
+     * @return socket_t
+     */
+    socket_t recvSocket() const { return m_recvSock; }
+
+    /**
+     * @brief 受信イベントを待機するためのハンドルを返します
+     * @details io_uringバックエンドでは受信はリングで行われるため、リングのファイル記述子を返す。
+     * それ以外では受信ソケットを返す。EventReactorへの登録にはこのハンドルを使用すること。
+     * ハンドルは構成後に変わらない(受信中のエラーではリングを再投入し、通常のソケットAPIへは切り替えない)
+     * @return socket_t
+     */
+    socket_t eventHandle() const override
+    {
+#ifdef UDP_HANDLER_HAS_IO_URING
+        if (m_uringReceiver)
+        {
+            return m_uringReceiver->fd();
+        }
+#endif
+        return m_recvSock;
+    }
+
+    /**
+     * @brief 使用中の入出力方式を返します
+     * @details io_uringを要求しても利用できなかった場合はIoBackend::Socketを返す
+     * @return IoBackend
+     */
+    IoBackend backend() const
+    {
+#ifdef UDP_HANDLER_HAS_IO_URING
+        if (m_uringReceiver)
+        {
+            return IoBackend::IoUring;
+        }
+#endif
+        return IoBackend::Socket;
+    }
+
+    /**
+     * @brief 送信ソケットを返します
+     *
+     * @return socket_t
+     */
+    socket_t sendSocket() const override { return m_sendSock; }
+
+    /**
+     * @brief 送受信統計を返します
+     *
+     * @return const UdpStats&
+     */
+    const UdpStats &stats() const { return m_stats; }
+
+    /**
+     * @brief 構成オプションを返します
+     *
+     * @return const UdpOptions&
+     */
+    const UdpOptions &options() const { return m_options; }
+
+    static bool startupSock()
+    {
+#ifdef _WIN32
+
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+        {
+            spdlog::error("WSAStartup failed");
+            return false;
+        }
+#endif
+        return true;
+    }
+    static void cleanupSock()
+    {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    };
+
+private:
+    /**
+     * @brief 受信ソケットが読み込み可能になるまで待機します
+     * @details スピン予算が設定されている場合は先にスピンする。スピンはtimeoutMsを超えず、
+     * スピンに費やした時間はブロッキング待機の時間から差し引く
+     * @param timeoutMs タイムアウト時間[msec](負値の場合は無期限)
+     * @return true 読み込み可能
+     * @return false タイムアウトまたはエラー
+     */
+    bool waitReadable(int timeoutMs)
+    {
+        if (m_options.spinBudgetUs > 0 && timeoutMs != 0)
+        {
+            using namespace std::chrono;
+            const auto start = steady_clock::now();
+            auto budget = microseconds(m_options.spinBudgetUs);
+            if (timeoutMs > 0)
+            {
+                budget = std::min<microseconds>(budget, milliseconds(timeoutMs));
+            }
+            if (spinReadable(budget))
+            {
+                return true;
+            }
+            if (timeoutMs > 0)
+            {
+                // 端数は切り上げ、合計の待機時間がtimeoutMsを超えないようにする
+                const auto spentUs = duration_cast<microseconds>(steady_clock::now() - start).count();
+                timeoutMs = std::max(0, timeoutMs - static_cast<int>((spentUs + 999) / 1000));
+            }
+        }
+#ifdef _WIN32
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(m_recvSock, &readfds);
+
+        // timeoutMs を秒／マイクロ秒に分割
+        timeval tv;
+        tv.tv_sec = timeoutMs / 1000;
+        tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+        int nfds = static_cast<int>(m_recvSock + 1);
+        int sel = select(nfds, &readfds, nullptr, nullptr, &tv);
+        if (sel == SOCK_ERR)
+        {
+            spdlog::error("select() failed: " + std::to_string(GET_ERROR()));
+            return false;
+        }
+        return sel > 0 && FD_ISSET(m_recvSock, &readfds);
+#else
+        // poll()はselect()と異なりFD_SETSIZEによるソケット番号の制限がない
+        pollfd pfd{m_recvSock, POLLIN, 0};
+        int ret = poll(&pfd, 1, timeoutMs);
+        if (ret == SOCK_ERR)
+        {
+            if (GET_ERROR() != EINTR)
+            {
+                spdlog::error("poll() failed: " + std::to_string(GET_ERROR()));
+            }
+            return false;
+        }
+        return ret > 0 && (pfd.revents & POLLIN);
+#endif
+    }
+
+    /**
+     * @brief スピン予算の間、非ブロッキングで受信ソケットを確認し続けます
+     * @details スリープと起床を伴わないため、到着から検知までの遅延とそのばらつきを抑えられる代わりに、
+     * 待機中もCPUを消費する。SO_BUSY_POLLを設定した場合、各確認でカーネルがNICのキューを直接ポーリングする。
+     * 消費時間と検知の成否はUdpStatsに集計する。遅延の分布はrxTimestampingを有効にしてreceiveDelay()で確認できる
+     * @param budget スピンする時間(スピン予算と呼び出し元のタイムアウトの短い方)
+     * @return true 読み込み可能
+     * @return false スピン予算内に到着しなかった
+     */
+    bool spinReadable(std::chrono::microseconds budget)
+    {
+        using namespace std::chrono;
+        const auto start = steady_clock::now();
+        const auto deadline = start + budget;
+        bool ready = false;
+        auto now = start;
+        do
+        {
+            m_stats.spinIterations++;
+#ifdef _WIN32
+            u_long available = 0;
+            ready = ioctlsocket(m_recvSock, FIONREAD, &available) == 0 && available > 0;
+#else
+            // 長さ0のMSG_PEEKでデータグラムを取り出さずに到着を確認する
+            ready = recv(m_recvSock, nullptr, 0, MSG_PEEK | MSG_DONTWAIT) != SOCK_ERR ||
+                    (errno != EAGAIN && errno != EWOULDBLOCK);
+#endif
+            now = steady_clock::now();
+        } while (!ready && now < deadline);
+        m_stats.spinNanoseconds += static_cast<uint64_t>(duration_cast<nanoseconds>(now - start).count());
+        if (ready)
+        {
+            m_stats.spinHits++;
+        }
+        else
+        {
+            m_stats.spinMisses++;
+        }
+        return ready;
+    }
+
+    /**
+     * @brief io_uringバックエンドを初期化します
+     * @details io_uringを利用できない場合(マルチショットrecvmsgが受け付けられない場合を含む)は警告を出力し、
+     * 通常のソケットAPIで処理を継続する。切り替えはeventHandle()を公開する前の構成時にのみ行う
+     */
+    void setupIoUring()
+    {
+#ifdef UDP_HANDLER_HAS_IO_URING
+        try
+        {
+            m_uringReceiver = std::make_unique<IoUringReceiver>(
+                m_recvSock, m_pool.slotSize(), kControlSize, m_options.ioUringBuffers, m_options.ioUringEntries);
+            m_uringSender = std::make_unique<IoUringSender>(m_sendSock, m_options.ioUringEntries);
+        }
+        catch (const std::system_error &ex)
+        {
+            m_uringReceiver.reset();
+            m_uringSender.reset();
+            spdlog::warn(std::string("io_uring unavailable, falling back to socket API: ") + ex.what());
+        }
+#else
+        spdlog::warn("io_uring is not supported on this platform, falling back to socket API");
+#endif
+    }
+
+#ifdef UDP_HANDLER_HAS_IO_URING
+    /**
+     * @brief io_uringバックエンドによる一括受信処理
+     * @details 前回返したバッファをカーネルへ戻してから、完了したデータグラムを取り出す。
+     * recvmsgが失敗した場合はリングに再投入して受信を継続する。eventHandle()を登録済みの利用者が
+     * 待機し続けられるよう、通常のソケットAPIへは切り替えない
+     * @param maxCount 取り出す最大データグラム数
+     * @param timeoutMs タイムアウト時間[msec]
+     * @return const ReceiveBatch&
+     */
+    const ReceiveBatch &receiveBatchIoUring(size_t maxCount, int timeoutMs)
+    {
+        m_uringReceiver->recycle();
+        m_uringDatagrams.clear();
+        int err = m_uringReceiver->reap(maxCount, timeoutMs, m_uringDatagrams);
+        for (const auto &datagram : m_uringDatagrams)
+        {
+            if (acceptDatagram(datagram.header, datagram.length))
+            {
+                appendSegments(m_batch.m_views, datagram.data, datagram.length);
+                m_batch.m_timestamps.resize(m_batch.m_views.size(), m_lastTimestamp);
+            }
+        }
+        if (err < 0)
+        {
+            // 失敗が続く場合に備え、ログ出力は1,2,4,8...回目のみに抑える
+            m_stats.ioUringErrors++;
+            if ((m_stats.ioUringErrors & (m_stats.ioUringErrors - 1)) == 0)
+            {
+                spdlog::warn("io_uring recvmsg failed, re-armed: " + std::to_string(-err) +
+                             " (total " + std::to_string(m_stats.ioUringErrors) + ")");
+            }
+        }
+        return m_batch;
+    }
+#endif
+
+    /**
+     * @brief IPv4アドレスがマルチキャストアドレス(224.0.0.0/4)かを判定します
+     *
+     * @param addr 判定するアドレス
+     * @return bool
+     */
+    static bool isMulticastAddress(const in_addr &addr)
+    {
+        return (ntohl(addr.s_addr) & 0xF0000000u) == 0xE0000000u;
+    }
+
+    /**
+     * @brief インターフェースのIPv4アドレスを変換します
+     *
+     * @param interfaceIp インターフェースのIPv4アドレス(空の場合はINADDR_ANY)
+     * @return in_addr
+     */
+    static in_addr interfaceAddress(const std::string &interfaceIp)
+    {
+        if (interfaceIp.empty())
+        {
+            in_addr any{};
+            any.s_addr = htonl(INADDR_ANY);
+            return any;
+        }
+        return makeAddress(interfaceIp, 0).sin_addr;
+    }
+
+    /**
+     * @brief マルチキャストグループへの参加状態を変更します
+     *
+     * @param option IP_ADD_MEMBERSHIPまたはIP_DROP_MEMBERSHIP
+     * @param group グループのIPv4アドレス
+     * @param interfaceIp インターフェースのIPv4アドレス
+     * @param label ログ出力用のオプション名
+     * @return true 変更成功
+     * @return false 変更失敗
+     */
+    bool changeMembership(int option, const std::string &group, const std::string &interfaceIp, const char *label)
+    {
+        ip_mreq mreq{};
+        mreq.imr_multiaddr = makeAddress(group, 0).sin_addr;
+        mreq.imr_interface = interfaceAddress(interfaceIp);
+        if (!isMulticastAddress(mreq.imr_multiaddr))
+        {
+            throw std::invalid_argument(group + " is not a multicast address");
+        }
+        if (setsockopt(m_recvSock, IPPROTO_IP, option, reinterpret_cast<const char *>(&mreq), sizeof(mreq)) == SOCK_ERR)
+        {
+            spdlog::warn(std::string("setsockopt(") + label + ", " + group + ") failed: " + std::to_string(GET_ERROR()));
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief マルチキャスト送信のオプション(TTL、ループバック、送信インターフェース)を送信ソケットに反映します
+     *
+     */
+    void applyMulticastSendOptions(socket_t sock)
+    {
+        setSocketOption(sock, IPPROTO_IP, IP_MULTICAST_TTL, m_options.multicastTtl, "IP_MULTICAST_TTL");
+        setSocketOption(sock, IPPROTO_IP, IP_MULTICAST_LOOP, m_options.multicastLoopback ? 1 : 0, "IP_MULTICAST_LOOP");
+        if (!m_options.multicastInterface.empty())
+        {
+            const in_addr iface = interfaceAddress(m_options.multicastInterface);
+            if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, reinterpret_cast<const char *>(&iface), sizeof(iface)) == SOCK_ERR)
+            {
+                spdlog::warn("setsockopt(IP_MULTICAST_IF) failed: " + std::to_string(GET_ERROR()));
+            }
+        }
+    }
+
+    /**
+     * @brief sendConcurrent()で使う、送信先へ接続したソケットを開きます
+     *
+     * @param error 失敗した場合のエラーコードの格納先
+     * @return socket_t 開いたソケット(失敗した場合はINVALID_SOCK)
+     */
+    socket_t openProducerSocket(int &error)
+    {
+        socket_t sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sock == INVALID_SOCK)
+        {
+            error = GET_ERROR();
+            return INVALID_SOCK;
+        }
+        if (m_options.socketSendBuffer > 0)
+        {
+            setSocketOption(sock, SOL_SOCKET, SO_SNDBUF, m_options.socketSendBuffer, "SO_SNDBUF");
+        }
+        if (isMulticastAddress(m_sendAddr.sin_addr))
+        {
+            applyMulticastSendOptions(sock);
+        }
+        if (connect(sock, reinterpret_cast<const sockaddr *>(&m_sendAddr), sizeof(m_sendAddr)) == SOCK_ERR)
+        {
+            error = GET_ERROR();
+            CLOSE_SOCKET(sock);
+            return INVALID_SOCK;
+        }
+        return sock;
+    }
+
+    /**
+     * @brief 送信前にペーシングを行います
+     * @details ソフトウェアによるペーシングでは出発時刻まで待機する。SO_TXTIMEが有効な場合は待機せずに出発時刻を返す
+     * @param bytes 送信するバイト数
+     * @param packets 送信するデータグラム数
+     * @return uint64_t SO_TXTIMEで指定する出発時刻[nsec](0の場合は指定しない)
+     */
+    uint64_t pace(size_t bytes, size_t packets = 1)
+    {
+        if (!m_pacer.enabled())
+        {
+            return 0;
+        }
+        const auto departure = m_pacer.reserve(bytes, packets);
+        if (m_txTimeEnabled)
+        {
+            return toTxTime(departure);
+        }
+        waitForDeparture(departure);
+        return 0;
+    }
+
+    /**
+     * @brief 出発時刻まで待機します
+     *
+     * @param departure 出発時刻
+     */
+    void waitForDeparture(TokenBucket::Clock::time_point departure)
+    {
+        const auto start = TokenBucket::Clock::now();
+        if (departure <= start)
+        {
+            return;
+        }
+        TokenBucket::waitUntil(departure);
+        m_stats.pacedSends++;
+        m_stats.pacingWaitNanoseconds += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(TokenBucket::Clock::now() - start).count());
+    }
+
+    /**
+     * @brief 出発時刻をSO_TXTIMEの形式に変換します
+     * @details LinuxのSTLではsteady_clockはCLOCK_MONOTONICである
+     * @param departure 出発時刻
+     * @return uint64_t 出発時刻[nsec]
+     */
+    static uint64_t toTxTime(TokenBucket::Clock::time_point departure)
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(departure.time_since_epoch()).count());
+    }
+
+    /**
+     * @brief 構成オプションをソケットに反映します
+     *
+     */
+    void applySocketOptions()
+    {
+        if (m_options.socketRecvBuffer > 0)
+        {
+            setSocketOption(m_recvSock, SOL_SOCKET, SO_RCVBUF, m_options.socketRecvBuffer, "SO_RCVBUF");
+        }
+        if (m_options.socketSendBuffer > 0)
+        {
+            setSocketOption(m_sendSock, SOL_SOCKET, SO_SNDBUF, m_options.socketSendBuffer, "SO_SNDBUF");
+        }
+#ifdef __linux__
+        // 受信キュー溢れによる破棄数を補助データで受け取る
+        setSocketOption(m_recvSock, SOL_SOCKET, SO_RXQ_OVFL, 1, "SO_RXQ_OVFL");
+        if (m_options.udpGro)
+        {
+            setSocketOption(m_recvSock, SOL_UDP, UDP_GRO, 1, "UDP_GRO");
+        }
+        if (m_options.zeroCopyThreshold > 0)
+        {
+            m_zeroCopyEnabled = setSocketOption(m_sendSock, SOL_SOCKET, SO_ZEROCOPY, 1, "SO_ZEROCOPY");
+        }
+        if (m_options.busyPollUs > 0)
+        {
+            // 既定値(net.core.busy_read)を超える値の設定にはCAP_NET_ADMINが必要
+            setSocketOption(m_recvSock, SOL_SOCKET, SO_BUSY_POLL, m_options.busyPollUs, "SO_BUSY_POLL");
+        }
+        if (m_options.rxTimestamping)
+        {
+            setSocketOption(m_recvSock, SOL_SOCKET, SO_TIMESTAMPNS, 1, "SO_TIMESTAMPNS");
+        }
+        if (m_options.txTimestamping)
+        {
+            // 送信時刻はデータグラムの通し番号と共にエラーキューで受け取る(ペイロードは返さない)
+            setSocketOption(m_sendSock, SOL_SOCKET, SO_TIMESTAMPING,
+                            SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                                SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY,
+                            "SO_TIMESTAMPING");
+        }
+        if (m_options.pacingTxTime && m_pacer.enabled())
+        {
+            // 出発時刻を守るのはfq/etf qdiscのため、それ以外のqdiscでは直ちに送信される
+            sock_txtime config{CLOCK_MONOTONIC, 0};
+            if (setsockopt(m_sendSock, SOL_SOCKET, SO_TXTIME, &config, sizeof(config)) == SOCK_ERR)
+            {
+                spdlog::warn("setsockopt(SO_TXTIME) failed, falling back to software pacing: " + std::to_string(GET_ERROR()));
+            }
+            else
+            {
+                m_txTimeEnabled = true;
+            }
+        }
+#else
+        if (m_options.udpGro || m_options.zeroCopyThreshold > 0 || m_options.rxTimestamping || m_options.txTimestamping || m_options.busyPollUs > 0 ||
+            m_options.pacingTxTime)
+        {
+            spdlog::warn("UDP_GRO/MSG_ZEROCOPY/timestamping/SO_BUSY_POLL/SO_TXTIME are not supported on this platform");
+        }
+#endif
+    }
+
+#ifdef __linux__
+    /**
+     * @brief 1回のGSO送信にまとめる最大バイト数を返します
+     *
+     * @param segmentSize セグメント長[byte]
+     * @return size_t
+     */
+    static size_t gsoChunkSize(uint16_t segmentSize)
+    {
+        const size_t perCall = std::max<size_t>(1, kMaxGsoBytes / segmentSize);
+        return std::min(perCall, kMaxGsoSegments) * segmentSize;
+    }
+
+    /**
+     * @brief GSOが利用できないことを示すエラーかを判定します
+     *
+     * @param err エラー番号
+     * @return true GSO非対応(カーネル、デバイスまたはオフロード設定)
+     */
+    static bool isGsoUnsupported(int err)
+    {
+        return err == EIO || err == EINVAL || err == ENOPROTOOPT || err == EOPNOTSUPP;
+    }
+
+    /**
+     * @brief 送信先へ1回のsendmsg()で送信します
+     * @details segmentSizeが0以外でlenより小さい場合はUDP_SEGMENTを補助データとして付与する
+     * @param data 送信するデータ
+     * @param len 送信するデータ長
+     * @param segmentSize GSOのセグメント長[byte](0の場合は指定しない)
+     * @param flags sendmsg()のフラグ
+     * @param txTime SO_TXTIMEで指定する出発時刻[nsec](0の場合は指定しない)
+     * @return true 送信成功
+     * @return false 送信失敗(errnoに原因が格納される)
+     */
+    bool sendSegment(const char *data, size_t len, uint16_t segmentSize, int flags, uint64_t txTime = 0)
+    {
+        iovec iov;
+        iov.iov_base = const_cast<char *>(data);
+        iov.iov_len = len;
+        msghdr msg{};
+        msg.msg_name = &m_sendAddr;
+        msg.msg_namelen = sizeof(m_sendAddr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t)) + kTxTimeControlSize];
+        const bool segmented = segmentSize > 0 && len > segmentSize;
+        if (segmented || txTime != 0)
+        {
+            std::memset(control, 0, sizeof(control));
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            size_t used = 0;
+            if (segmented)
+            {
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                std::memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+                used += CMSG_SPACE(sizeof(uint16_t));
+                cmsg = CMSG_NXTHDR(&msg, cmsg);
+            }
+            if (txTime != 0)
+            {
+                used += addTxTime(cmsg, txTime);
+            }
+            msg.msg_controllen = used;
+        }
+        ssize_t sent;
+        do
+        {
+            sent = sendmsg(m_sendSock, &msg, flags);
+        } while (sent == SOCK_ERR && errno == EINTR);
+        return sent != SOCK_ERR;
+    }
+
+    /**
+     * @brief 補助データにSO_TXTIMEの出発時刻を書き込みます
+     *
+     * @param cmsg 書き込み先の補助データ
+     * @param txTime 出発時刻[nsec](CLOCK_MONOTONIC)
+     * @return size_t 使用した補助データのバイト数
+     */
+    static size_t addTxTime(cmsghdr *cmsg, uint64_t txTime)
+    {
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_TXTIME;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+        std::memcpy(CMSG_DATA(cmsg), &txTime, sizeof(txTime));
+        return kTxTimeControlSize;
+    }
+
+    /**
+     * @brief 送信ソケットのエラーキューを読み出し、完了通知を処理します
+     * @details MSG_ZEROCOPYの完了通知は連番の範囲[ee_info, ee_data]で届くため、
+     * 範囲内の送信で保持していたバッファを解放する。送信時刻の通知は通し番号(ee_data)と共に保持する
+     */
+    void drainErrorQueue()
+    {
+        char control[kControlSize];
+        for (;;)
+        {
+            msghdr msg{};
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            if (recvmsg(m_sendSock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == SOCK_ERR)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                {
+                    spdlog::warn("recvmsg(MSG_ERRQUEUE) failed: " + std::to_string(errno));
+                }
+                return;
+            }
+            std::optional<KernelTimestamp> txTime;
+            for (auto *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+                {
+                    // ts[0]がソフトウェアタイムスタンプ
+                    timespec ts[3];
+                    std::memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+                    txTime = toKernelTimestamp(ts[0]);
+                    continue;
+                }
+                if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR)
+                {
+                    continue;
+                }
+                sock_extended_err err;
+                std::memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+                if (err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING && txTime)
+                {
+                    if (m_txTimestamps.size() >= kMaxTxTimestamps)
+                    {
+                        m_txTimestamps.pop_front();
+                    }
+                    m_txTimestamps.push_back(TxTimestamp{err.ee_data, *txTime});
+                    continue;
+                }
+                if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0)
+                {
+                    continue;
+                }
+                const uint32_t first = err.ee_info;
+                const uint32_t count = err.ee_data - first + 1;
+                m_stats.zeroCopyCompleted += count;
+                if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                {
+                    m_stats.zeroCopyCopied += count;
+                }
+                while (!m_zeroCopyInFlight.empty() && m_zeroCopyInFlight.front().first - first < count)
+                {
+                    m_zeroCopyInFlight.pop_front();
+                }
+            }
+        }
+    }
+#endif
+
+#ifdef __linux__
+    /**
+     * @brief timespecをKernelTimestampに変換します
+     *
+     * @param ts CLOCK_REALTIME基準の時刻
+     * @return KernelTimestamp
+     */
+    static KernelTimestamp toKernelTimestamp(const timespec &ts)
+    {
+        return KernelTimestamp(std::chrono::duration_cast<KernelTimestamp::duration>(
+            std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+    }
+#endif
+
+    /**
+     * @brief int型のソケットオプションを設定します
+     * @details 設定に失敗した場合は警告を出力して処理を継続する
+     * @param sock 対象ソケット
+     * @param level オプションのレベル
+     * @param name オプション名
+     * @param value 設定値
+     * @param label ログ出力用のオプション名
+     * @return true 設定成功
+     * @return false 設定失敗
+     */
+    static bool setSocketOption(socket_t sock, int level, int name, int value, const char *label)
+    {
+        if (setsockopt(sock, level, name, reinterpret_cast<const char *>(&value), sizeof(value)) == SOCK_ERR)
+        {
+            spdlog::warn(std::string("setsockopt(") + label + ") failed: " + std::to_string(GET_ERROR()));
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 切り詰められたデータグラムを計上します
+     *
+     * @param bufferSize 受信バッファサイズ
+     */
+    void countTruncated(size_t bufferSize)
+    {
+        m_stats.truncated++;
+        spdlog::warn("datagram truncated and discarded (buffer " + std::to_string(bufferSize) +
+                     " bytes, total " + std::to_string(m_stats.truncated) + ")");
+    }
+
+#ifndef _WIN32
+    /**
+     * @brief 受信したデータグラムの補助データを処理し、受け入れ可否を判定します
+     *
+     * @param hdr 受信したメッセージヘッダ
+     * @param len 受信長(MSG_TRUNC指定時は切り詰め前の長さ)
+     * @return true 受け入れ可能
+     * @return false 切り詰められたため破棄
+     */
+    bool acceptDatagram(const msghdr &hdr, size_t len)
+    {
+        m_stats.received++;
+        m_lastSegmentSize = 0;
+        m_lastTimestamp = KernelTimestamp{};
+        for (auto *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(const_cast<msghdr *>(&hdr), cmsg))
+        {
+#ifdef __linux__
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+            {
+                uint32_t dropped;
+                std::memcpy(&dropped, CMSG_DATA(cmsg), sizeof(dropped));
+                m_stats.dropped = dropped;
+            }
+            else if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+            {
+                int segmentSize;
+                std::memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(segmentSize));
+                if (segmentSize > 0 && static_cast<size_t>(segmentSize) < len)
+                {
+                    m_lastSegmentSize = static_cast<size_t>(segmentSize);
+                    m_stats.groCoalesced++;
+                    // 結合されたセグメント数を受信数に加算する
+                    m_stats.received += (len - 1) / m_lastSegmentSize;
+                }
+            }
+            else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+            {
+                timespec ts;
+                std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                m_lastTimestamp = toKernelTimestamp(ts);
+                // カーネルの受信から取り出しまでの待ち時間を記録する
+                m_receiveDelay.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::system_clock::now() - m_lastTimestamp)
+                                          .count());
+            }
+#endif
+        }
+        if ((hdr.msg_flags & MSG_TRUNC) || len > m_pool.slotSize())
+        {
+            countTruncated(m_pool.slotSize());
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    /**
+     * @brief 受信したデータを出力先に追加します
+     * @details 直前のacceptDatagram()でGROのセグメント長が得られた場合は、セグメントごとに分割して追加する
+     * @param out 出力先
+     * @param data 受信データ
+     * @param len 受信長
+     */
+    void appendSegments(std::vector<std::string_view> &out, const char *data, size_t len)
+    {
+        if (m_lastSegmentSize == 0)
+        {
+            out.emplace_back(data, len);
+            return;
+        }
+        for (size_t offset = 0; offset < len; offset += m_lastSegmentSize)
+        {
+            out.emplace_back(data + offset, std::min(m_lastSegmentSize, len - offset));
+        }
+    }
+
+    /**
+     * @brief 一括受信用のバッファとI/Oベクタを最低count件分確保します
+     * @details receiveView()がバッファプールのみを確保している場合があるため、それぞれ個別に確保する
+     * @param count 確保するデータグラム数
+     */
+    void reserveBatch(size_t count)
+    {
+        m_pool.reserve(count);
+        m_controlPool.reserve(count);
+        m_batch.m_views.reserve(count);
+#ifdef __linux__
+        if (m_batchMsgs.size() < count)
+        {
+            m_batchIovecs.resize(count);
+            m_batchMsgs.resize(count);
+        }
+#endif
+    }
+
+private:
+    static constexpr size_t kMaxGatherParts = 8; //! sendGather()で連結できる最大領域数
+    static constexpr size_t kControlSize = 256;  //! データグラム1件あたりの補助データ(cmsg)バッファサイズ
+    static constexpr size_t kMaxGsoSegments = 64;   //! 1回のGSO送信にまとめる最大セグメント数(カーネルの上限)
+    static constexpr size_t kMaxGsoBytes = 65507;   //! 1回のGSO送信の最大バイト数(IPv4のUDPペイロード上限)
+    static constexpr size_t kMaxTxTimestamps = 1024; //! 未回収の送信時刻を保持する最大件数
+#ifdef __linux__
+    static constexpr size_t kTxTimeControlSize = CMSG_SPACE(sizeof(uint64_t)); //! SO_TXTIMEの補助データのバイト数
+#endif
+
+    UdpOptions m_options;
+    UdpStats m_stats;
+    socket_t m_recvSock{INVALID_SOCK};
+    socket_t m_sendSock{INVALID_SOCK};
+    sockaddr_in m_recvAddr{};
+    sockaddr_in m_sendAddr{};
+
+    ReceiveBatch m_batch;             //! 一括受信結果のビュー
+    std::vector<std::string_view> m_pending; //! receiveView()で未返却のGROセグメント
+    size_t m_pendingIndex{0};                //! m_pendingの次に返す位置
+    size_t m_lastSegmentSize{0};             //! 直前に受信したデータグラムのGROセグメント長(0の場合は結合なし)
+    KernelTimestamp m_lastTimestamp;         //! 直前に受信したデータグラムのカーネル受信時刻
+    LatencyHistogram m_receiveDelay;         //! カーネル受信から取り出しまでの待ち時間
+    std::deque<TxTimestamp> m_txTimestamps;  //! 未回収の送信時刻
+    BufferPool m_pool;                      //! 受信用の再利用バッファ
+    BufferPool m_controlPool{kControlSize}; //! 受信時の補助データ(cmsg)用バッファ
+    SendBatch m_segmentBatch;               //! GSOを使用できない場合のセグメント送信用
+    bool m_gsoSupported{true};              //! UDP_SEGMENTが使用可能か(失敗した時点で無効化)
+    bool m_zeroCopyEnabled{false};          //! SO_ZEROCOPYが有効か
+    uint32_t m_zeroCopyNextId{0};           //! 次のMSG_ZEROCOPY送信に割り当てられる連番
+    std::deque<std::pair<uint32_t, std::shared_ptr<const std::string>>> m_zeroCopyInFlight; //! 完了通知待ちの送信バッファ
+    TokenBucket m_pacer;                    //! 送信のペーシング
+    bool m_txTimeEnabled{false};            //! SO_TXTIMEでペーシングするか
+    ProducerSockets m_producers{[this](int &error)
+                                { return openProducerSocket(error); }}; //! sendConcurrent()で使う送信スレッドごとのソケット
+#ifdef __linux__
+    std::vector<iovec> m_batchIovecs; //! recvmmsg()に渡すI/Oベクタ
+    std::vector<mmsghdr> m_batchMsgs; //! recvmmsg()に渡すメッセージヘッダ
+    std::vector<iovec> m_sendIovecs;  //! sendmmsg()に渡すI/Oベクタ
+    std::vector<mmsghdr> m_sendMsgs;  //! sendmmsg()に渡すメッセージヘッダ
+    std::vector<char> m_sendControl;  //! sendmmsg()に渡す補助データ(SO_TXTIME)
+    std::vector<TokenBucket::Clock::time_point> m_departures; //! sendBatch()の各データグラムの出発時刻
+#endif
+#ifdef UDP_HANDLER_HAS_IO_URING
+    std::unique_ptr<IoUringReceiver> m_uringReceiver;       //! io_uringによる受信処理
+    std::unique_ptr<IoUringSender> m_uringSender;           //! io_uringによる送信処理
+    std::vector<IoUringReceiver::Datagram> m_uringDatagrams; //! io_uringで受信したデータグラム
+    std::vector<int> m_sendErrors;                          //! io_uringによる送信結果
+#endif
 };
 #endif // UdpHandler_hpp
\ No newline at end of file
@@ -0,0 +1,788 @@
+/**
+ * @file UnixDatagramHandler.hpp
+ * @brief AF_UNIXソケットによる同一ホスト内トランスポートの定義ファイル
+ * @details 処理の可搬性を重視するため、ヘッダ内のみに処理をまとめている。
+ * WindowsはAF_UNIXのSOCK_DGRAM/SOCK_SEQPACKETに対応していないため、POSIX環境でのみ定義する
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#ifndef UNIX_DATAGRAM_HANDLER_HPP_
+#define UNIX_DATAGRAM_HANDLER_HPP_
+
+#include "DatagramTransport.hpp"
+#include "ProducerSockets.hpp"
+
+#ifndef _WIN32
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "spdlog/spdlog.h"
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/**
+ * @brief AF_UNIXソケットの種類
+ */
+enum class UnixSocketType
+{
+    Datagram,  //! SOCK_DGRAM(コネクションレス。送信先のパスへ直接送る)
+    SeqPacket, //! SOCK_SEQPACKET(コネクション型。メッセージ境界を保ち、64KiBの上限がない)
+};
+
+/**
+ * @brief UnixDatagramHandlerの構成オプション
+ */
+struct UnixOptions
+{
+    UnixSocketType type{UnixSocketType::Datagram}; //! ソケットの種類
+    size_t recvBufferSize{kMaxDatagramSize};      //! メッセージ1件あたりの受信バッファサイズ[byte](64KiBを超えてもよい)
+    int socketRecvBuffer{0};                      //! 受信ソケットのSO_RCVBUF[byte](0の場合はOS既定値)
+    int socketSendBuffer{0};                      //! 送信ソケットのSO_SNDBUF[byte](0の場合はOS既定値)
+};
+
+/**
+ * @brief UnixDatagramHandlerの送受信統計
+ */
+struct UnixStats
+{
+    uint64_t received{0};     //! 受信したメッセージ数(切り詰めにより破棄したものを含む)
+    uint64_t truncated{0};    //! 受信バッファに収まらず破棄したメッセージ数
+    uint64_t sent{0};         //! 送信したメッセージ数
+    uint64_t sendErrors{0};   //! 送信に失敗したメッセージ数
+    uint64_t accepted{0};     //! 受け付けた接続数(SeqPacketのみ)
+    uint64_t disconnected{0}; //! 切断された接続数(SeqPacketのみ)
+};
+
+/**
+ * @brief AF_UNIXソケットで同一ホスト内のプロセスとメッセージを送受信するクラス
+ * @details UdpHandlerと同様に受信用と送信用の端点を持ち、受信パスにbindして送信パスへ送る。
+ * ループバックのUDP/IPスタックを経由しないため、同一ホスト内では遅延が小さい。
+ * SeqPacketでは受信パスで接続を待ち受け(複数の送信元を受け付ける)、送信パスへは最初の送信時に接続する。
+ * 送信先が停止して接続が切れた場合は、次の送信時に再接続する
+ */
+class UnixDatagramHandler : public DatagramTransport
+{
+public:
+    using DatagramTransport::sendGather;
+
+    /**
+     * @brief 新しいAF_UNIX処理オブジェクトを構成します
+     * @details 受信パスに残っている古いソケットファイルは削除してからbindする
+     * @param recvPath 受信用ソケットのパス
+     * @param sendPath 送信先ソケットのパス
+     * @param options 構成オプション
+     */
+    UnixDatagramHandler(const std::string &recvPath, const std::string &sendPath,
+                        const UnixOptions &options = UnixOptions{})
+        : m_options(options), m_recvPath(recvPath), m_pool(options.recvBufferSize)
+    {
+        if (options.recvBufferSize == 0)
+        {
+            throw std::invalid_argument("recvBufferSize must be positive");
+        }
+        m_recvAddr = makeUnixAddress(recvPath);
+        m_sendAddr = makeUnixAddress(sendPath);
+        const int type = socketType();
+
+        // 受信ソケット初期化
+        m_recvSock = socket(AF_UNIX, type, 0);
+        if (m_recvSock == INVALID_SOCK)
+        {
+            throw std::runtime_error("unix recv socket() failed: " + std::to_string(GET_ERROR()));
+        }
+        removeStaleSocket(recvPath);
+        if (bind(m_recvSock, reinterpret_cast<const sockaddr *>(&m_recvAddr), sizeof(m_recvAddr)) == SOCK_ERR)
+        {
+            const int err = GET_ERROR();
+            CLOSE_SOCKET(m_recvSock);
+            throw std::runtime_error("bind(" + recvPath + ") failed: " + std::to_string(err));
+        }
+        if (isSeqPacket())
+        {
+            // 受け付けは受信処理の中で待たずに行う
+            if (listen(m_recvSock, kBacklog) == SOCK_ERR ||
+                fcntl(m_recvSock, F_SETFL, fcntl(m_recvSock, F_GETFL) | O_NONBLOCK) == SOCK_ERR)
+            {
+                const int err = GET_ERROR();
+                closeAll();
+                throw std::runtime_error("listen(" + recvPath + ") failed: " + std::to_string(err));
+            }
+#ifdef __linux__
+            // 待ち受けソケットと受け付けた接続をまとめて1つのハンドルで待機できるようにする
+            m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+            if (m_epollFd == -1 || !watch(m_recvSock))
+            {
+                const int err = GET_ERROR();
+                closeAll();
+                throw std::runtime_error("epoll setup failed: " + std::to_string(err));
+            }
+#endif
+        }
+        else
+        {
+            applyBufferSize(m_recvSock, SO_RCVBUF, m_options.socketRecvBuffer, "SO_RCVBUF");
+            // 送信ソケット初期化(SeqPacketでは最初の送信時に接続する)
+            m_sendSock = socket(AF_UNIX, SOCK_DGRAM, 0);
+            if (m_sendSock == INVALID_SOCK)
+            {
+                const int err = GET_ERROR();
+                closeAll();
+                throw std::runtime_error("unix send socket() failed: " + std::to_string(err));
+            }
+            applyBufferSize(m_sendSock, SO_SNDBUF, m_options.socketSendBuffer, "SO_SNDBUF");
+        }
+    }
+
+    /**
+     * @brief AF_UNIX処理オブジェクトを破棄します
+     * @details ソケットを閉じ、受信パスのソケットファイルを削除する
+     */
+    ~UnixDatagramHandler() override
+    {
+        closeAll();
+    }
+
+    UnixDatagramHandler(const UnixDatagramHandler &) = delete;
+    UnixDatagramHandler &operator=(const UnixDatagramHandler &) = delete;
+
+    /**
+     * @brief データ受信処理(コピーなし)
+     * @details 受信したデータは内部のバッファプールに格納し、その領域を参照するビューを返す。
+     * 戻り値は次の受信処理を呼び出すまで有効
+     * @param timeoutMs タイムアウト時間[msec]
+     * @return std::optional<std::string_view> 受信したデータ(未受信の場合はstd::nullopt)
+     */
+    std::optional<std::string_view> receiveView(int timeoutMs = 100) override
+    {
+        m_pool.reserve(1);
+        size_t len = 0;
+        if (!readNext(m_pool.slot(0), len))
+        {
+            if (!waitReadable(timeoutMs) || !readNext(m_pool.slot(0), len))
+            {
+                return std::nullopt;
+            }
+        }
+        return std::string_view(m_pool.slot(0), len);
+    }
+
+    /**
+     * @brief 受信キューに溜まっているメッセージをまとめて受信します
+     *
+     * @param maxCount 1回で取り出す最大メッセージ数
+     * @param timeoutMs タイムアウト時間[msec](0の場合は待機しない)
+     * @return const ReceiveBatch& 受信したメッセージ群(次の受信処理を呼び出すまで有効)
+     */
+    const ReceiveBatch &receiveBatch(size_t maxCount = 16, int timeoutMs = 100) override
+    {
+        m_batch.m_views.clear();
+        m_batch.m_timestamps.clear();
+        if (maxCount == 0)
+        {
+            return m_batch;
+        }
+        m_pool.reserve(maxCount);
+        size_t len = 0;
+        while (m_batch.m_views.size() < maxCount)
+        {
+            char *slot = m_pool.slot(m_batch.m_views.size());
+            if (!readNext(slot, len))
+            {
+                if (!m_batch.empty() || timeoutMs == 0 || !waitReadable(timeoutMs) || !readNext(slot, len))
+                {
+                    break;
+                }
+            }
+            m_batch.m_views.emplace_back(slot, len);
+        }
+        return m_batch;
+    }
+
+    /**
+     * @brief メッセージを送信
+     *
+     * @param msg 送信するメッセージ
+     */
+    void send(const std::string &msg) override
+    {
+        const std::string_view part(msg);
+        sendParts(&part, 1, 0);
+    }
+
+    /**
+     * @brief 複数の領域を連結して1つのメッセージとして送信
+     *
+     * @param parts 送信する領域の配列
+     * @param count 領域の数(kMaxGatherParts以下)
+     * @return true 送信成功
+     * @return false 送信失敗
+     */
+    bool sendGather(const std::string_view *parts, size_t count) override
+    {
+        return sendParts(parts, count, 0) == 0;
+    }
+
+    /**
+     * @brief 複数の領域を連結して1つのメッセージとして送信(複数スレッドから同時に呼び出し可能)
+     * @details 呼び出し元スレッドごとに送信先へconnect()したソケットを使う(初回の呼び出し時に開く)。
+     * SeqPacketではスレッドごとに接続を張るため、受信側ではスレッド数分の接続を受け付ける。
+     * 結果はstats()ではなくproducerStats()に集計する
+     * @param parts 送信する領域の配列
+     * @param count 領域の数(ProducerSockets::kMaxGatherParts以下)
+     * @return true 送信成功
+     * @return false 送信失敗
+     */
+    bool sendConcurrent(const std::string_view *parts, size_t count) override
+    {
+        return m_producers.send(parts, count) == 0;
+    }
+
+    /**
+     * @brief sendConcurrent()の送信統計を返します
+     *
+     * @return ProducerStats
+     */
+    ProducerStats producerStats() const { return m_producers.stats(); }
+
+    /**
+     * @brief 複数のメッセージを一括送信
+     * @details 送信先を指定したエントリ(UDPアドレス)は送信せず、EAFNOSUPPORTとして報告する。
+     * 送信バッファが満杯(EAGAIN)の場合は、順序を保つため残りを送信せずに同じエラーとして返す
+     * @param batch 送信するメッセージ群(各要素に送信結果が格納される)
+     * @return SendBatchResult 送信結果の概要
+     */
+    SendBatchResult sendBatch(SendBatch &batch) override
+    {
+        SendBatchResult result;
+        int blocked = 0;
+        for (auto &entry : batch.m_entries)
+        {
+            entry.error = blocked != 0 ? blocked : entry.dest ? EAFNOSUPPORT : sendParts(&entry.payload, 1, 0);
+            if (entry.error == EAGAIN || entry.error == EWOULDBLOCK)
+            {
+                blocked = entry.error;
+            }
+            entry.sent = entry.error == 0;
+            entry.sentBytes = entry.sent ? entry.payload.size() : 0;
+            if (entry.sent)
+            {
+                result.sentCount++;
+                continue;
+            }
+            result.failedCount++;
+            if (result.firstError == 0)
+            {
+                result.firstError = entry.error;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief 待機せずにメッセージを送信
+     *
+     * @param msg 送信するメッセージ
+     * @return int 0:送信成功、EAGAIN:送信バッファが満杯、それ以外:エラーコード
+     */
+    int trySend(std::string_view msg) override
+    {
+        return sendParts(&msg, 1, MSG_DONTWAIT);
+    }
+
+    /**
+     * @brief 受信イベントを待機するためのハンドルを返します
+     * @details SeqPacketでは、Linuxでは待ち受けソケットと全ての接続をまとめたepollのハンドルを返す。
+     * それ以外の環境では待ち受けソケットを返すため、接続済みの受信の検知にはreceive系の関数の待機を使用すること
+     * @return socket_t
+     */
+    socket_t eventHandle() const override
+    {
+#ifdef __linux__
+        if (m_epollFd != -1)
+        {
+            return m_epollFd;
+        }
+#endif
+        return m_recvSock;
+    }
+
+    /**
+     * @brief 送信ソケットを返します
+     * @details SeqPacketで未接続の場合はINVALID_SOCKを返す
+     * @return socket_t
+     */
+    socket_t sendSocket() const override { return m_sendSock; }
+
+    /**
+     * @brief 受け付け済みの接続数を返します(SeqPacketのみ)
+     *
+     * @return size_t
+     */
+    size_t connectionCount() const { return m_conns.size(); }
+
+    /**
+     * @brief 送受信統計を返します
+     *
+     * @return const UnixStats&
+     */
+    const UnixStats &stats() const { return m_stats; }
+
+    /**
+     * @brief 構成オプションを返します
+     *
+     * @return const UnixOptions&
+     */
+    const UnixOptions &options() const { return m_options; }
+
+private:
+    bool isSeqPacket() const { return m_options.type == UnixSocketType::SeqPacket; }
+    int socketType() const { return isSeqPacket() ? SOCK_SEQPACKET : SOCK_DGRAM; }
+
+    /**
+     * @brief パスからAF_UNIXのアドレスを生成します
+     *
+     * @param path ソケットのパス
+     * @return sockaddr_un
+     */
+    static sockaddr_un makeUnixAddress(const std::string &path)
+    {
+        sockaddr_un addr{};
+        if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        {
+            throw std::invalid_argument("unix socket path must be 1.." + std::to_string(sizeof(addr.sun_path) - 1) + " bytes: " + path);
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return addr;
+    }
+
+    /**
+     * @brief 前回の実行で残ったソケットファイルを削除します
+     * @details ソケット以外のファイルは削除しない(bindが失敗する)
+     * @param path ソケットのパス
+     */
+    static void removeStaleSocket(const std::string &path)
+    {
+        struct stat st;
+        if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        {
+            unlink(path.c_str());
+        }
+    }
+
+    /**
+     * @brief ソケットのバッファサイズを設定します
+     *
+     * @param sock 対象ソケット
+     * @param name SO_RCVBUFまたはSO_SNDBUF
+     * @param size バッファサイズ[byte](0の場合は設定しない)
+     * @param label ログ出力用のオプション名
+     */
+    static void applyBufferSize(socket_t sock, int name, int size, const char *label)
+    {
+        if (size > 0 && setsockopt(sock, SOL_SOCKET, name, &size, sizeof(size)) == SOCK_ERR)
+        {
+            spdlog::warn(std::string("setsockopt(") + label + ") failed: " + std::to_string(GET_ERROR()));
+        }
+    }
+
+    /**
+     * @brief 受信できるメッセージを1件、待たずに読み出します
+     * @details 受信バッファに収まらないメッセージは破棄して次を読む。
+     * SeqPacketでは接続を順に確認し、切断された接続は閉じる
+     * @param buf 受信先(recvBufferSizeバイト)
+     * @param len 受信したバイト数
+     * @return true 受信した
+     * @return false 読み出せるメッセージが無い
+     */
+    bool readNext(char *buf, size_t &len)
+    {
+        if (!isSeqPacket())
+        {
+            return readFrom(m_recvSock, buf, len) > 0;
+        }
+        acceptPending();
+        for (size_t tried = 0; tried < m_conns.size();)
+        {
+            const size_t index = m_nextConn % m_conns.size();
+            const int ret = readFrom(m_conns[index], buf, len);
+            if (ret > 0)
+            {
+                return true;
+            }
+            if (ret < 0)
+            {
+                closeConnection(index);
+                continue;
+            }
+            // 接続間の公平性のため、次回は次の接続から確認する
+            m_nextConn = index + 1;
+            tried++;
+        }
+        return false;
+    }
+
+    /**
+     * @brief ソケットから受信できるメッセージを1件、待たずに読み出します
+     *
+     * @param sock 対象ソケット
+     * @param buf 受信先
+     * @param len 受信したバイト数
+     * @return int 1:受信した、0:読み出せるメッセージが無い、-1:接続が切れた
+     */
+    int readFrom(socket_t sock, char *buf, size_t &len)
+    {
+        for (;;)
+        {
+            iovec iov{buf, m_pool.slotSize()};
+            msghdr hdr{};
+            hdr.msg_iov = &iov;
+            hdr.msg_iovlen = 1;
+            ssize_t ret = recvmsg(sock, &hdr, MSG_DONTWAIT | MSG_TRUNC);
+            if (ret == SOCK_ERR)
+            {
+                const int err = GET_ERROR();
+                if (err == EINTR)
+                {
+                    continue;
+                }
+                if (err == EAGAIN || err == EWOULDBLOCK)
+                {
+                    return 0;
+                }
+                if (isSeqPacket())
+                {
+                    return -1;
+                }
+                spdlog::warn("unix recvmsg() failed: " + std::to_string(err));
+                return 0;
+            }
+            if (ret == 0)
+            {
+                // SeqPacketでは相手の切断、Datagramでは空のメッセージ
+                if (isSeqPacket())
+                {
+                    return -1;
+                }
+                m_stats.received++;
+                continue;
+            }
+            m_stats.received++;
+            if ((hdr.msg_flags & MSG_TRUNC) || static_cast<size_t>(ret) > m_pool.slotSize())
+            {
+                m_stats.truncated++;
+                spdlog::warn("unix message truncated (" + std::to_string(ret) + " bytes > buffer " +
+                             std::to_string(m_pool.slotSize()) + " bytes)");
+                continue;
+            }
+            len = static_cast<size_t>(ret);
+            return 1;
+        }
+    }
+
+    /**
+     * @brief 受信可能になるまで待機します
+     * @details SeqPacketでは、新しい接続の受け付けのみで受信が無い場合は残り時間だけ待機を続ける
+     * @param timeoutMs タイムアウト時間[msec]
+     * @return true 受信可能になった
+     * @return false タイムアウトまたはエラー
+     */
+    bool waitReadable(int timeoutMs)
+    {
+        using namespace std::chrono;
+        const auto deadline = steady_clock::now() + milliseconds(timeoutMs);
+        for (;;)
+        {
+            m_pollFds.clear();
+            m_pollFds.push_back(pollfd{m_recvSock, POLLIN, 0});
+            for (auto conn : m_conns)
+            {
+                m_pollFds.push_back(pollfd{conn, POLLIN, 0});
+            }
+            const auto remaining = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+            int ret = poll(m_pollFds.data(), m_pollFds.size(), timeoutMs < 0 ? -1 : static_cast<int>(std::max<long long>(0, remaining)));
+            if (ret == SOCK_ERR)
+            {
+                if (GET_ERROR() != EINTR)
+                {
+                    spdlog::error("poll() failed: " + std::to_string(GET_ERROR()));
+                }
+                return false;
+            }
+            if (ret == 0)
+            {
+                return false;
+            }
+            if (!isSeqPacket() || ret > 1 || !(m_pollFds[0].revents & POLLIN))
+            {
+                return true;
+            }
+            acceptPending();
+        }
+    }
+
+    /**
+     * @brief 待ち受けソケットに届いている接続を全て受け付けます(SeqPacketのみ)
+     *
+     */
+    void acceptPending()
+    {
+        for (;;)
+        {
+            socket_t conn = accept(m_recvSock, nullptr, nullptr);
+            if (conn == INVALID_SOCK)
+            {
+                const int err = GET_ERROR();
+                if (err != EAGAIN && err != EWOULDBLOCK && err != EINTR)
+                {
+                    spdlog::warn("accept() failed: " + std::to_string(err));
+                }
+                return;
+            }
+            applyBufferSize(conn, SO_RCVBUF, m_options.socketRecvBuffer, "SO_RCVBUF");
+#ifdef __linux__
+            if (!watch(conn))
+            {
+                CLOSE_SOCKET(conn);
+                continue;
+            }
+#endif
+            m_conns.push_back(conn);
+            m_stats.accepted++;
+        }
+    }
+
+    /**
+     * @brief 受け付けた接続を閉じます
+     *
+     * @param index 接続の位置
+     */
+    void closeConnection(size_t index)
+    {
+#ifdef __linux__
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_conns[index], nullptr);
+#endif
+        CLOSE_SOCKET(m_conns[index]);
+        m_conns.erase(m_conns.begin() + static_cast<std::ptrdiff_t>(index));
+        m_stats.disconnected++;
+    }
+
+#ifdef __linux__
+    /**
+     * @brief ソケットを受信待機用のepollに登録します
+     *
+     * @param sock 対象ソケット
+     * @return true 登録成功
+     * @return false 登録失敗
+     */
+    bool watch(socket_t sock)
+    {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = sock;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, sock, &ev) == -1)
+        {
+            spdlog::warn("epoll_ctl(ADD) failed: " + std::to_string(errno));
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    /**
+     * @brief sendConcurrent()で使う、送信先へ接続したソケットを開きます
+     *
+     * @param error 失敗した場合のエラーコードの格納先
+     * @return socket_t 開いたソケット(失敗した場合はINVALID_SOCK)
+     */
+    socket_t openProducerSocket(int &error)
+    {
+        socket_t sock = socket(AF_UNIX, socketType(), 0);
+        if (sock == INVALID_SOCK)
+        {
+            error = GET_ERROR();
+            return INVALID_SOCK;
+        }
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        applyBufferSize(sock, SO_SNDBUF, m_options.socketSendBuffer, "SO_SNDBUF");
+        if (connect(sock, reinterpret_cast<const sockaddr *>(&m_sendAddr), sizeof(m_sendAddr)) == SOCK_ERR)
+        {
+            error = GET_ERROR();
+            CLOSE_SOCKET(sock);
+            return INVALID_SOCK;
+        }
+        return sock;
+    }
+
+    /**
+     * @brief 送信先へ接続します(SeqPacketのみ)
+     * @details 接続済みの場合は何もしない。送信先が起動していない場合は失敗し、次の送信時に再試行する
+     * @return int 0:接続済み、それ以外:エラーコード
+     */
+    int ensureConnected()
+    {
+        if (m_sendSock != INVALID_SOCK)
+        {
+            return 0;
+        }
+        socket_t sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+        if (sock == INVALID_SOCK)
+        {
+            return GET_ERROR();
+        }
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        applyBufferSize(sock, SO_SNDBUF, m_options.socketSendBuffer, "SO_SNDBUF");
+        if (connect(sock, reinterpret_cast<const sockaddr *>(&m_sendAddr), sizeof(m_sendAddr)) == SOCK_ERR)
+        {
+            const int err = GET_ERROR();
+            CLOSE_SOCKET(sock);
+            return err;
+        }
+        m_sendSock = sock;
+        return 0;
+    }
+
+    /**
+     * @brief 複数の領域を連結して1つのメッセージとして送信します
+     *
+     * @param parts 送信する領域の配列
+     * @param count 領域の数(kMaxGatherParts以下)
+     * @param flags sendmsg()のフラグ
+     * @return int 0:送信成功、それ以外:エラーコード
+     */
+    int sendParts(const std::string_view *parts, size_t count, int flags)
+    {
+        if (count > kMaxGatherParts)
+        {
+            throw std::invalid_argument("sendGather() supports up to " + std::to_string(kMaxGatherParts) + " parts");
+        }
+        int err = isSeqPacket() ? ensureConnected() : 0;
+        if (err == 0)
+        {
+            iovec iov[kMaxGatherParts];
+            for (size_t i = 0; i < count; ++i)
+            {
+                iov[i].iov_base = const_cast<char *>(parts[i].data());
+                iov[i].iov_len = parts[i].size();
+            }
+            msghdr msg{};
+            if (!isSeqPacket())
+            {
+                msg.msg_name = &m_sendAddr;
+                msg.msg_namelen = sizeof(m_sendAddr);
+            }
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            while (sendmsg(m_sendSock, &msg, flags | MSG_NOSIGNAL) == SOCK_ERR)
+            {
+                err = GET_ERROR();
+                if (err != EINTR)
+                {
+                    break;
+                }
+                err = 0;
+            }
+        }
+        if (err == 0)
+        {
+            m_stats.sent++;
+            return 0;
+        }
+        if (err == EAGAIN || err == EWOULDBLOCK)
+        {
+            return err;
+        }
+        m_stats.sendErrors++;
+        if (isSeqPacket() && m_sendSock != INVALID_SOCK && err != EMSGSIZE)
+        {
+            // 接続が切れた場合は次の送信で再接続する
+            CLOSE_SOCKET(m_sendSock);
+            m_sendSock = INVALID_SOCK;
+        }
+        // sendBatch()からも呼ばれ、送信先の停止中は毎回失敗するため、ログ出力は1,2,4,8...回目のみに抑える
+        // (個々の結果はSendBatch::Entry::errorと戻り値で返す)
+        if ((m_stats.sendErrors & (m_stats.sendErrors - 1)) == 0)
+        {
+            spdlog::warn("unix send failed: " + std::to_string(err) +
+                         " (total " + std::to_string(m_stats.sendErrors) + ")");
+        }
+        return err;
+    }
+
+    /**
+     * @brief 全てのソケットを閉じ、受信パスのソケットファイルを削除します
+     *
+     */
+    void closeAll()
+    {
+        for (auto conn : m_conns)
+        {
+            CLOSE_SOCKET(conn);
+        }
+        m_conns.clear();
+#ifdef __linux__
+        if (m_epollFd != -1)
+        {
+            close(m_epollFd);
+            m_epollFd = -1;
+        }
+#endif
+        if (m_sendSock != INVALID_SOCK)
+        {
+            CLOSE_SOCKET(m_sendSock);
+            m_sendSock = INVALID_SOCK;
+        }
+        if (m_recvSock != INVALID_SOCK)
+        {
+            CLOSE_SOCKET(m_recvSock);
+            m_recvSock = INVALID_SOCK;
+            unlink(m_recvPath.c_str());
+        }
+    }
+
+private:
+    static constexpr size_t kMaxGatherParts = 8; //! sendGather()で連結できる最大領域数
+    static constexpr int kBacklog = 16;          //! SeqPacketの接続待ちキューの長さ
+
+    UnixOptions m_options;
+    UnixStats m_stats;
+    std::string m_recvPath;                //! 受信用ソケットのパス
+    sockaddr_un m_recvAddr{};
+    sockaddr_un m_sendAddr{};
+    socket_t m_recvSock{INVALID_SOCK};     //! 受信ソケット(SeqPacketでは待ち受けソケット)
+    socket_t m_sendSock{INVALID_SOCK};     //! 送信ソケット(SeqPacketでは送信先への接続)
+    std::vector<socket_t> m_conns;         //! 受け付けた接続(SeqPacketのみ)
+    size_t m_nextConn{0};                  //! 次に受信を確認する接続の位置
+    std::vector<pollfd> m_pollFds;         //! poll()に渡す監視対象
+    ReceiveBatch m_batch;                  //! 一括受信結果のビュー
+    BufferPool m_pool;                     //! 受信用の再利用バッファ
+    ProducerSockets m_producers{[this](int &error)
+                                { return openProducerSocket(error); }}; //! sendConcurrent()で使う送信スレッドごとのソケット
+#ifdef __linux__
+    int m_epollFd{-1}; //! 待ち受けソケットと接続をまとめたepollインスタンス(SeqPacketのみ)
+#endif
+};
+
+#endif // _WIN32
+
+#endif // UNIX_DATAGRAM_HANDLER_HPP_
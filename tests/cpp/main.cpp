@@ -7,9 +7,11 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <cstring>
 #include <csignal>
 #include <vector>
+#include "EventReactor.hpp"
 #include "MqttBridge.hpp"
 #include "PlotPoints.hpp"
 #include "Simulation.hpp"
@@ -43,6 +45,32 @@ void setupLogger()
     spdlog::flush_every(std::chrono::seconds(1));
 }
 
+/**
+ * @brief 受信したコマンド(realtime/command)をシミュレーションに反映します
+ *
+ * @param simulation 操作対象のシミュレーション
+ * @param message 受信したメッセージ本体(JSON)
+ */
+void handleCommand(Simulation &simulation, std::string_view message)
+{
+    auto subJson = nlohmann::json::parse(message);
+    if (subJson.contains("command"))
+    {
+        if (subJson["command"] == "start")
+        {
+            simulation.start();
+        }
+        else if (subJson["command"] == "stop")
+        {
+            simulation.stop();
+        }
+        else if (subJson["command"] == "reset")
+        {
+            simulation.reset();
+        }
+    }
+}
+
 int main()
 {
     try
@@ -60,51 +88,58 @@ int main()
             spdlog::error("MqttBridge initalize failure.");
             return EXIT_FAILURE;
         }
-        // MQTT中継を初期化
-        MqttBridge mqtt("127.0.0.1", 5653, "127.0.0.1", 6565);
+        // MQTT中継を初期化(コマンドの受信待ち時間を計測するためカーネルの受信時刻を取得)
+        UdpOptions options;
+        options.rxTimestamping = true;
+        MqttBridge mqtt("127.0.0.1", 5653, "127.0.0.1", 6565, options);
+        // 送信の停滞でシミュレーション更新が止まらないよう、発行は送信キュー経由で行う
+        // (最新の位置情報を優先するため、溢れた場合は古いものから破棄)
+        SendQueueOptions queueOptions;
+        queueOptions.capacity = 64;
+        queueOptions.policy = OverflowPolicy::DropOldest;
+        mqtt.enableSendQueue(queueOptions);
 
         // シミュレーションを構築
         Simulation simulation;
 
-        while (!g_isStopped.load())
-        {
-            // メッセージ受信をトライ
-            auto body = mqtt.subscribe();
-            if (body)
-            { // 受信できていれば内容を取得
-                auto topicMessage = body.value();
-                auto subJson = nlohmann::json::parse(topicMessage.second);
-                if (topicMessage.first == "realtime/command" && subJson.contains("command"))
-                {
-                    if (subJson["command"] == "start")
-                    {
-                        simulation.start();
-                    }
-                    else if (subJson["command"] == "stop")
-                    {
-                        simulation.stop();
-                    }
-                    else if (subJson["command"] == "reset")
-                    {
-                        simulation.reset();
-                    }
-                }
-            }
+        // 使用するトピックをIDに登録(以降の発行・振り分けでトピック文字列を検索しない)
+        const TopicId pointsTopic = mqtt.internTopic("realtime/3dpoints");
+        mqtt.internTopic("realtime/command");
 
-            // シミュレーションを更新
-            simulation.update();
+        // トピックごとの受信ハンドラを登録
+        mqtt.addHandler("realtime/command", [&](std::string_view, std::string_view message)
+                        { handleCommand(simulation, message); });
+
+        // 受信したコマンドは到着次第、シミュレーション更新は1秒周期で処理
+        EventReactor reactor;
+        reactor.addReader(mqtt.eventHandle(), [&]()
+                          {
+            // 受信キューに溜まっているメッセージをまとめて振り分け
+            mqtt.dispatch(16, 0); });
+        reactor.setTick(std::chrono::seconds(1), [&](uint64_t expirations)
+                        {
+            // シミュレーションを更新(期限を逃した周期分も進める)
+            for (uint64_t i = 0; i < expirations; ++i)
+            {
+                simulation.update();
+            }
 
             nlohmann::json pubJson;
             plotmsg::to_json(pubJson, simulation.getPlotPoints());
             std::string payload = pubJson.dump();
-            mqtt.publish("realtime/3dpoints", payload);
+            mqtt.publish(pointsTopic, payload);
 
             // ペイロードをdumpログに出力
-            spdlog::get("dump")->info(payload);
+            spdlog::get("dump")->info(payload); });
+
+        reactor.run(g_isStopped);
+        spdlog::info("command queueing delay: " + mqtt.receiveDelay().summary());
+        const auto queueStats = mqtt.sendQueue()->stats();
+        spdlog::info("publish queue: enqueued=" + std::to_string(queueStats.enqueued) +
+                     " sent=" + std::to_string(queueStats.sent) +
+                     " dropped=" + std::to_string(queueStats.droppedOldest) +
+                     " highWatermark=" + std::to_string(queueStats.highWatermark));
 
-            // 1秒スリープ
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-        }
         // dumpファイルを出力
         spdlog::get("dump")->flush();
         MqttBridge::cleanupSock();
@@ -0,0 +1,197 @@
+/**
+ * @file AsyncLoopTest.cpp
+ * @brief AsyncLoopとBasicMqttBridge::async_subscribe()によるメッセージ配送のテスト
+ * @details 以下を確認する
+ * - 購読したコルーチンが別の待機(sleep_forなど)で中断している間に届いたメッセージを取りこぼさない
+ * - 再開したコルーチンが同じMQTT中継で受信しても、同じエンベロープに含まれる残りのメッセージが壊れない
+ * - 分割されたフレームを再構成して、内容を損なわずに渡す
+ * C++20のコルーチンが利用できない場合は何も確認せずに成功する
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "AsyncLoop.hpp"
+
+#ifdef UDP_HANDLER_HAS_COROUTINE
+namespace
+{
+    constexpr int kSenderPort = 47701;   //! 送信側のポート番号
+    constexpr int kReceiverPort = 47702; //! 受信側のポート番号
+    constexpr int kRawPort = 47703;      //! MQTT中継を介さずに送信する側のポート番号
+    constexpr int kTimeoutMs = 1000;     //! 購読の最大待機時間[msec]
+
+    /**
+     * @brief 購読したメッセージの記録
+     */
+    struct Received
+    {
+        std::vector<std::string> messages; //! 受信したメッセージ本体(受信順)
+        bool finished{false};              //! コルーチンが終了したか
+    };
+
+    /**
+     * @brief 1件購読してから中断し、その間に届いたメッセージを続けて購読します
+     */
+    AsyncTask subscribeWithPause(AsyncLoop &loop, MqttBridge &bridge, Received &out)
+    {
+        if (auto message = co_await bridge.async_subscribe(loop, "pause/x", kTimeoutMs))
+        {
+            out.messages.push_back(*message);
+        }
+        co_await loop.sleep_for(std::chrono::milliseconds(50));
+        for (int i = 0; i < 2; ++i)
+        {
+            if (auto message = co_await bridge.async_subscribe(loop, "pause/x", kTimeoutMs))
+            {
+                out.messages.push_back(*message);
+            }
+        }
+        out.finished = true;
+    }
+
+    /**
+     * @brief 指定したトピックを指定件数購読します
+     */
+    AsyncTask subscribeCount(AsyncLoop &loop, MqttBridge &bridge, std::string topic, int count, Received &out)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            auto message = co_await bridge.async_subscribe(loop, topic, kTimeoutMs);
+            if (!message)
+            {
+                break;
+            }
+            out.messages.push_back(*message);
+        }
+        out.finished = true;
+    }
+
+    /**
+     * @brief 1件購読した直後に、別のデータグラムを届けさせて同じMQTT中継で同期的に受信します(受信バッファの上書きを起こす)
+     */
+    AsyncTask subscribeThenReceive(AsyncLoop &loop, MqttBridge &bridge, UdpHandler &raw, Received &out)
+    {
+        if (auto message = co_await bridge.async_subscribe(loop, "env/a", kTimeoutMs))
+        {
+            out.messages.push_back(*message);
+        }
+        raw.send("env/c\n" + std::string(1000, 'z'));
+        bridge.subscribeBatch(16, 100);
+        bridge.subscribeView(0);
+        out.finished = true;
+    }
+
+    /**
+     * @brief 全ての記録が終了するまでループを駆動します
+     */
+    void runUntil(AsyncLoop &loop, const std::vector<const Received *> &records)
+    {
+        const auto deadline = AsyncLoop::Clock::now() + std::chrono::milliseconds(3 * kTimeoutMs);
+        auto finished = [&]()
+        {
+            for (const Received *record : records)
+            {
+                if (!record->finished)
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+        while (!finished() && AsyncLoop::Clock::now() < deadline)
+        {
+            loop.runOnce(10);
+        }
+    }
+
+    /**
+     * @brief 受信したメッセージが期待どおりか確認し、結果を出力します
+     */
+    bool expect(const char *name, const Received &received, const std::vector<std::string> &expected)
+    {
+        const bool ok = received.finished && received.messages == expected;
+        std::printf("%s: received %zu of %zu %s\n", name, received.messages.size(), expected.size(), ok ? "ok" : "NG");
+        return ok;
+    }
+}
+
+int main()
+{
+    MqttBridge sender("127.0.0.1", kSenderPort, "127.0.0.1", kReceiverPort);
+    MqttBridge receiver("127.0.0.1", kReceiverPort, "127.0.0.1", kSenderPort);
+    UdpHandler raw("127.0.0.1", kRawPort, "127.0.0.1", kReceiverPort);
+    AsyncLoop loop;
+    bool ok = true;
+
+    // 別の待機で中断している間に届いたメッセージ(他のトピックの購読待ちにより受信される)
+    {
+        Received paused;
+        Received other;
+        subscribeWithPause(loop, receiver, paused);
+        subscribeCount(loop, receiver, "pause/y", 1, other);
+        sender.publish("pause/x", "x1");
+        for (int i = 0; i < 5; ++i)
+        {
+            loop.runOnce(5);
+        }
+        sender.publish("pause/x", "x2");
+        sender.publish("pause/x", "x3");
+        sender.publish("pause/y", "y1");
+        runUntil(loop, {&paused, &other});
+        ok = expect("pause/x", paused, {"x1", "x2", "x3"}) && ok;
+        ok = expect("pause/y", other, {"y1"}) && ok;
+    }
+
+    // 再開したコルーチンが受信しても、同じエンベロープの残りのメッセージを壊さない
+    {
+        Received first;
+        Received second;
+        subscribeThenReceive(loop, receiver, raw, first);
+        subscribeCount(loop, receiver, "env/b", 2, second);
+        sender.enableCoalescing();
+        sender.publish("env/a", "a1");
+        sender.publish("env/b", "b1");
+        sender.publish("env/b", "b2");
+        sender.flushEnvelope();
+        runUntil(loop, {&first, &second});
+        ok = expect("env/a", first, {"a1"}) && ok;
+        ok = expect("env/b", second, {"b1", "b2"}) && ok;
+    }
+
+    // 分割されたフレームの再構成
+    {
+        FragmentOptions fragment;
+        fragment.maxDatagramSize = 1200;
+        sender.enableFragmentation(fragment);
+        receiver.enableFragmentation(fragment);
+        sender.enableCoalescing(CoalesceOptions{});
+        std::string large(10000, '\0');
+        for (size_t i = 0; i < large.size(); ++i)
+        {
+            large[i] = static_cast<char>('a' + i % 26);
+        }
+        Received frames;
+        subscribeCount(loop, receiver, "frag/x", 2, frames);
+        sender.publish("frag/x", large);
+        sender.publish("frag/x", "small");
+        sender.flushEnvelope();
+        runUntil(loop, {&frames});
+        ok = expect("frag/x", frames, {large, "small"}) && ok;
+    }
+
+    std::printf("subscribeDropped %llu\n", static_cast<unsigned long long>(loop.subscribeDropped()));
+    std::printf("%s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
+#else
+int main()
+{
+    std::printf("coroutines are not available; skipped\n");
+    return 0;
+}
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file PlotPointColumnsTest.cpp
+ * @brief PlotPointColumns::dumpJson()がnlohmann::jsonのdump()と同じ文字列を出力することを確認するテスト
+ * @details 非有限値(NaN、±inf)、-0.0、非正規化数、極端に大きい・小さい値を含む点群を、
+ * 倍精度(PlotPointColumns)と単精度(PlotPointColumnsF)の両方で比較する
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+#include "PlotPointColumns.hpp"
+
+namespace
+{
+    /**
+     * @brief 比較に使う値を返します
+     */
+    template <class Real>
+    std::vector<Real> sampleValues()
+    {
+        using Limits = std::numeric_limits<Real>;
+        return {Real(0), -Real(0), Real(1), Real(-1), Real(0.1), Real(1) / Real(3), Real(1e-7), Real(123456.789),
+                Limits::quiet_NaN(), -Limits::quiet_NaN(), Limits::infinity(), -Limits::infinity(),
+                Limits::denorm_min(), -Limits::denorm_min(), Limits::min() / Real(3), Limits::min(),
+                Limits::max(), Limits::lowest(), Limits::epsilon(), Real(1e15), Real(1e16), Real(1e17)};
+    }
+
+    /**
+     * @brief 比較に使うタイムスタンプを返します
+     */
+    std::vector<double> sampleTimestamps()
+    {
+        using Limits = std::numeric_limits<double>;
+        return {0.0, -0.0, 1752364800.123456, Limits::quiet_NaN(), Limits::infinity(), -Limits::infinity(),
+                Limits::denorm_min(), Limits::max(), Limits::lowest()};
+    }
+
+    /**
+     * @brief dumpJson()とnlohmann::jsonのdump()の出力を比較し、結果を出力します
+     */
+    template <class Real>
+    bool expectSameJson(const char *name, const plotmsg::BasicPlotPointColumns<Real> &columns)
+    {
+        const std::string direct = columns.dumpJson();
+        const std::string expected = plotmsg::json(columns).dump();
+        if (direct != expected)
+        {
+            std::printf("%s: NG\n  dumpJson: %s\n  dump:     %s\n", name, direct.c_str(), expected.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 値の組み合わせごとに点群を作成して比較します
+     */
+    template <class Real>
+    bool testPrecision(const char *name)
+    {
+        const std::vector<Real> values = sampleValues<Real>();
+        bool ok = true;
+        size_t cases = 0;
+
+        // 空の点群
+        plotmsg::BasicPlotPointColumns<Real> empty;
+        ok = expectSameJson(name, empty) && ok;
+        cases++;
+
+        // 各値を各座標に1点ずつ置き、タイムスタンプも変える
+        const std::vector<double> timestamps = sampleTimestamps();
+        for (double timestamp : timestamps)
+        {
+            plotmsg::BasicPlotPointColumns<Real> columns;
+            columns.setTimestamp(timestamp);
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                const Real value = values[i];
+                const Real other = values[(i + 7) % values.size()];
+                columns.push_back(static_cast<int64_t>(i), value, other, -value);
+            }
+            ok = expectSameJson(name, columns) && ok;
+            cases++;
+        }
+
+        // 識別子の範囲の端
+        plotmsg::BasicPlotPointColumns<Real> ids;
+        ids.push_back(std::numeric_limits<int64_t>::min(), values[0], values[1], values[2]);
+        ids.push_back(std::numeric_limits<int64_t>::max(), values[3], values[4], values[5]);
+        ids.push_back(-1, values[6], values[7], values[8]);
+        ok = expectSameJson(name, ids) && ok;
+        cases++;
+
+        std::printf("%s: %zu cases %s\n", name, cases, ok ? "ok" : "NG");
+        return ok;
+    }
+}
+
+int main()
+{
+    bool ok = true;
+    ok = testPrecision<double>("PlotPointColumns") && ok;
+    ok = testPrecision<float>("PlotPointColumnsF") && ok;
+    std::printf("%s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
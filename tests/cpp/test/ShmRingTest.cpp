@@ -0,0 +1,179 @@
+/**
+ * @file ShmRingTest.cpp
+ * @brief 共有メモリリングで破損したフレーム(読み出し途中で上書きされたフレーム)を返さないことを確認するテスト
+ * @details 書き込みスレッド1つと読み出しスレッド複数を同時に動かし、スロット数を小さくして上書きを頻発させる。
+ * 各フレームは通し番号から長さと内容が決まるため、読み出したフレームの長さと全バイトを検証できる
+ * @version 0.1
+ * @date 2025-07-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "ShmRing.hpp"
+
+namespace
+{
+    constexpr uint64_t kFrameCount = 100000;    //! 書き込むフレーム数
+    constexpr uint64_t kEndMarker = UINT64_MAX; //! 書き込み終了を示す通し番号
+    constexpr size_t kMaxBody = 65536;          //! フレーム本体の最大バイト数(通し番号を除く、コピーに時間がかかる大きさ)
+    constexpr size_t kReaderCount = 3;          //! 読み出しスレッド数
+    constexpr int kReceiveTimeoutMs = 5000;     //! 読み出しの最大待機時間[msec]
+
+    /**
+     * @brief 通し番号に対応するフレーム本体のバイト数を返します
+     */
+    size_t bodySize(uint64_t sequence)
+    {
+        return static_cast<size_t>((sequence * 37) % (kMaxBody + 1));
+    }
+
+    /**
+     * @brief 通し番号に対応するフレーム本体の値を返します(本体の全バイトが同じ値)
+     */
+    char bodyByte(uint64_t sequence)
+    {
+        return static_cast<char>((sequence * 131) & 0xff);
+    }
+
+    /**
+     * @brief フレームを生成します(先頭8バイトが通し番号、以降が本体)
+     */
+    std::string_view makeFrame(std::string &buffer, uint64_t sequence)
+    {
+        const size_t size = bodySize(sequence);
+        buffer.resize(sizeof(sequence) + size);
+        std::memcpy(&buffer[0], &sequence, sizeof(sequence));
+        std::memset(&buffer[sizeof(sequence)], bodyByte(sequence), size);
+        return buffer;
+    }
+
+    /**
+     * @brief 読み出しスレッドの結果
+     */
+    struct ReaderResult
+    {
+        uint64_t received{0};  //! 読み出したフレーム数
+        uint64_t lost{0};      //! 取りこぼしたフレーム数
+        uint64_t torn{0};      //! 長さまたは内容が一致しなかったフレーム数
+        uint64_t unordered{0}; //! 通し番号が前回以下だったフレーム数
+        bool finished{false};  //! 終了フレームまで読み出したか
+    };
+
+    /**
+     * @brief 終了フレームを受け取るまで読み出し、各フレームを検証します
+     */
+    void readFrames(ShmRingReader &reader, ReaderResult &result)
+    {
+        // 検証はmemcmp()で行い、読み出し側の処理時間の多くをリングからのコピーが占めるようにする
+        std::vector<std::string> patterns(256);
+        for (size_t value = 0; value < patterns.size(); ++value)
+        {
+            patterns[value].assign(kMaxBody, static_cast<char>(value));
+        }
+        bool hasLast = false;
+        uint64_t last = 0;
+        while (auto frame = reader.receiveView(kReceiveTimeoutMs))
+        {
+            uint64_t sequence = 0;
+            if (frame->size() < sizeof(sequence))
+            {
+                result.torn++;
+                continue;
+            }
+            std::memcpy(&sequence, frame->data(), sizeof(sequence));
+            if (sequence == kEndMarker)
+            {
+                result.finished = true;
+                break;
+            }
+            result.received++;
+            const std::string_view body = frame->substr(sizeof(sequence));
+            const bool intact = sequence < kFrameCount && body.size() == bodySize(sequence) &&
+                                std::memcmp(body.data(), patterns[static_cast<unsigned char>(bodyByte(sequence))].data(),
+                                            body.size()) == 0;
+            if (!intact)
+            {
+                result.torn++;
+            }
+            if (hasLast && sequence <= last)
+            {
+                result.unordered++;
+            }
+            hasLast = true;
+            last = sequence;
+        }
+        result.lost = reader.stats().lost;
+    }
+}
+
+int main()
+{
+    const std::string path =
+        (std::filesystem::temp_directory_path() / ("ShmRingTest." + std::to_string(getpid()) + ".ring")).string();
+    ShmRingOptions options;
+    // スロット数を小さくして、読み出し中の上書きを頻発させる
+    options.slotCount = 8;
+    options.slotSize = static_cast<uint32_t>(sizeof(uint64_t) + kMaxBody);
+    ShmRingWriter writer(path, options);
+
+    std::vector<ReaderResult> results(kReaderCount);
+    std::vector<std::thread> readers;
+    std::atomic<size_t> ready{0};
+    for (size_t i = 0; i < kReaderCount; ++i)
+    {
+        readers.emplace_back([&, i]()
+                             {
+            // スピンせずに待機させ、書き込み側と交互に動く場面も作る
+            ShmRingReader reader(path, i == 0 ? 0 : 50);
+            ready++;
+            readFrames(reader, results[i]); });
+    }
+    while (ready.load() < kReaderCount)
+    {
+        std::this_thread::yield();
+    }
+
+    std::string buffer;
+    for (uint64_t sequence = 0; sequence < kFrameCount; ++sequence)
+    {
+        writer.write(makeFrame(buffer, sequence));
+    }
+    const uint64_t end = kEndMarker;
+    writer.write(std::string_view(reinterpret_cast<const char *>(&end), sizeof(end)));
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    std::filesystem::remove(path);
+
+    bool ok = true;
+    uint64_t totalLost = 0;
+    for (size_t i = 0; i < kReaderCount; ++i)
+    {
+        const ReaderResult &result = results[i];
+        std::printf("reader %zu: received %llu lost %llu torn %llu unordered %llu finished %d\n", i,
+                    static_cast<unsigned long long>(result.received), static_cast<unsigned long long>(result.lost),
+                    static_cast<unsigned long long>(result.torn), static_cast<unsigned long long>(result.unordered),
+                    result.finished ? 1 : 0);
+        ok = ok && result.finished && result.received > 0 && result.torn == 0 && result.unordered == 0 &&
+             result.received + result.lost == kFrameCount;
+        totalLost += result.lost;
+    }
+    // 上書きが一度も起きなければ、破損の検出を確認できていない
+    if (totalLost == 0)
+    {
+        std::printf("no frame was overwritten; the test did not exercise concurrent overwrites\n");
+        ok = false;
+    }
+    std::printf("%s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}